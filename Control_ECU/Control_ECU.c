@@ -7,42 +7,67 @@
 // Control_ECU.c
 
 #include "main.h"
-volatile uint16 g_tick = 0;  // Global tick counter for timer
+volatile uint32 g_travelStart = 0;  // Systick time the current travel started, read by the power-fail handler
+volatile DoorStateType g_doorState = DOOR_LOCKED;  // Door position, read by the power-fail handler
+volatile DcMotor_State g_motorDirection = STOP;  // Current motor direction, read by the power-fail handler
+boolean g_settingsUnlocked = FALSE;  // Password given for COMMAND_SETTINGS, settings may be changed
+uint32 g_settingsTime = 0;  // Systick time of the unlock or of the last setting changed
+boolean g_pairingAllowed = FALSE;  // Pairing button held at power-up, the key goes out in plain only then
+static uint8 g_pendingMessage[LINK_MAX_PAYLOAD];  // Command that ended a wait for a new password, run by the main loop
+static uint8 g_pendingLength = 0;
 
-// Timer1 callback function to increment the global tick on each compare match
-void Timer1_callback(void) {
-	g_tick++;  // Increment the tick counter on each timer compare match
-}
+/*
+ * Commands from HMI_ECU, indexed by opcode and kept in flash. A new service
+ * operation is one more entry: handler computing the reply, work to run once
+ * the reply is sent, argument length and flags.
+ */
+static const Command_EntryType g_commandTable[COMMAND_TABLE_SIZE] PROGMEM = {
+	[COMMAND_OPEN_DOOR] = {verifyPasswordCommand, openDoorComplete, 1, COMMAND_FLAG_FRAMED},
+	[COMMAND_CHANGE_PASSWORD] = {verifyPasswordCommand, changePasswordComplete, 1, COMMAND_FLAG_FRAMED},
+	[COMMAND_SETTINGS] = {verifyPasswordCommand, settingsComplete, 1, COMMAND_FLAG_FRAMED},
+	[DIGIT_COMMAND] = {digitCommand, NULL_PTR, 2, COMMAND_FLAG_FRAMED},
+	[LINK_STATUS_COMMAND] = {linkStatusCommand, NULL_PTR, 0, 0},
+	[PAIR_COMMAND] = {pairCommand, NULL_PTR, 0, 0},
+	[LOCKOUT_STATUS_COMMAND] = {lockoutStatusCommand, NULL_PTR, 0, 0},
+	[CONFIG_GET_COMMAND] = {configGetCommand, NULL_PTR, 0, 0},
+	[CONFIG_SET_COMMAND] = {configSetCommand, NULL_PTR, 3, COMMAND_FLAG_FRAMED},
+	[PASSWORD_STATUS_COMMAND] = {passwordStatusCommand, NULL_PTR, 0, 0},
+#if PROFILE_ENABLE
+	[DIAG_COMMAND] = {diagCommand, NULL_PTR, 0, 0},
+#endif
+#if UART_FAULT_ENABLE
+	[LINK_BENCH_COMMAND] = {benchCommand, NULL_PTR, 1, COMMAND_FLAG_FRAMED},
+#endif
+};
 
-// Setup Timer1 with a 1-second interval using an 8MHz clock
-void setupTimer1(void) {
-	Timer_ConfigType timerConfig = {0, 7812, TIMER_1, TIMER_CLOCK_1024, TIMER_COMPARE_MODE};  // Configure timer for 1-second interval
-	Timer_init(&timerConfig);  // Initialize the timer with the specified configuration
-	Timer_setCallBack(Timer1_callback, TIMER_1);  // Set the callback function for Timer1
-}
+/*
+ * Lockout length after the attempts limit, in units of the configured
+ * lockout time. Each lockout in a row doubles the wait, the last entry
+ * repeats until a right password is entered.
+ */
+static const uint8 g_lockoutScale[LOCKOUT_LEVELS] PROGMEM = {1, 2, 4, 8, 16, 30};
 
-// Stop Timer1 by deinitializing it
-void Timer1Stop(void) {
-	Timer_deInit(TIMER_1);  // Deinitialize Timer1 to stop it
-}
+/*
+ * Buzzer patterns, in BUZZER_STEP_MS steps. The lockout alarm outranks the
+ * short feedback beeps, so a wrong password cannot cut it short.
+ */
+static const Buzzer_PatternType g_chirpPattern PROGMEM = {BUZZER_PRIORITY_FEEDBACK, 1, {6}};
+static const Buzzer_PatternType g_errorPattern PROGMEM = {BUZZER_PRIORITY_FEEDBACK, 1, {15, 10, 15}};
+static const Buzzer_PatternType g_alarmPattern PROGMEM = {BUZZER_PRIORITY_ALARM, BUZZER_REPEAT_FOREVER, {25, 25}};
 
 // Main function for Control_ECU operation
 int main(void) {
 	initializeSystem();  // Initialize the system peripherals
 	sei();  // Enable global interrupts
-	receiveAndVerifyPasswords();  // Start the process of receiving and verifying the passwords
+	restoreCheckpoint();  // Re-lock the door if the last power loss left it open (needs the motor interrupts)
+	relink(0);  // Agree on the fastest link rate HMI_ECU can use
+	receiveNewPassword();  // Start the process of receiving the password
 
 	// Main loop to listen for commands and handle operations
 	while (1) {
-		uint8 command = UART_recieveByte();  // Receive the command from HMI_ECU
-		if (command == COMMAND_OPEN_DOOR || command == COMMAND_CHANGE_PASSWORD) {
-			// If the command is to open the door or change password, verify password for operation
-			receiveAndVerifyPasswordForOperation(command);
-		}
-		else if (command == TRY_AGAIN) {
-			// If the command is to try again, re-verify passwords
-			receiveAndVerifyPasswords();
-		}
+		uint8 message[LINK_MAX_PAYLOAD];
+		uint8 length = receiveMessage(message);
+		Command_dispatch(message, length);  // Run the command received from HMI_ECU
 	}
 }
 
@@ -51,118 +76,474 @@ void initializeSystem() {
 	UART_ConfigType uartConfig = {8, 0, 1, 9600};  // UART configuration for 9600 baud rate
 	TWI_ConfigType twiConfig = {0x01, 12};  // I2C configuration (for any future peripheral, e.g., PIR sensor)
 	UART_init(&uartConfig);  // Initialize UART
+	Command_init(g_commandTable);  // Commands accepted from HMI_ECU
+	ADC_init();  // Initialize the ADC for current and supply sensing
 	TWI_init(&twiConfig);  // Initialize TWI (I2C)
+	EEPROM_BUF_init();  // Initialize the EEPROM write-back buffer
+	Config_load();  // Installer settings, before anything timed by them
 	DcMotor_Init();  // Initialize DC motor for door operation
 	Buzzer_init();  // Initialize Buzzer for alerts
 	PIR_init();  // Initialize PIR sensor for motion detection
+	PowerMonitor_init();  // Initialize the brown-out detector
+	Systick_init();  // 1 ms timebase for the door and lockout timing
+	if (Timer_hasConflict() || !Speck_selfTest()) {
+		// Two drivers were configured on the same timer resource, or the link cipher is broken: never drive the door like this
+		Buzzer_on();
+		while (1);
+	}
+	setupLinkKey();  // Before the scan starts: a new key is drawn from polled ADC conversions
+	Lockout_PolicyType policy;
+	getLockoutPolicy(&policy);
+	Lockout_init(&policy);  // Failures and lockout survive a reset
+	if (Lockout_isActive()) {
+		Buzzer_play(&g_alarmPattern);  // Resume the alarm of a lockout cut short by a reset
+	}
+	PowerMonitor_setCallBack(powerFailHandler);  // Save state when the supply collapses
+	PowerMonitor_waitForRecovery();  // Do not move the motor on a sagging supply
+	ADC_startSlowScan();  // Watch the supply in the background, without waking the CPU between ticks
+}
+
+// Called from the ADC interrupt while the supply is collapsing
+void powerFailHandler(void) {
+	DoorCheckpointType checkpoint;
+
+	DcMotor_Rotate(STOP, 0);  // Cut the motor first, it is by far the biggest load
+	TWI_recover();  // The main flow may have been interrupted in the middle of a transaction
+
+	checkpoint.magic = CHECKPOINT_MAGIC;
+	checkpoint.doorState = g_doorState;
+	checkpoint.motorDirection = g_motorDirection;
+	uint32 travelled = Systick_elapsedSince(g_travelStart) / 1000;
+	uint8 travelTime = (uint8)Config_get()->doorTravelTime;
+	checkpoint.travelTime = (travelled > travelTime) ? travelTime : (uint8)travelled;
+	checkpoint.pendingBytes = EEPROM_BUF_pendingBytes();
+	checkpoint.crc = checkpointCrc(&checkpoint);
+
+	// One page write is the fastest way to make the checkpoint durable
+	EEPROM_writePage(CHECKPOINT_ADDRESS, (const uint8 *)&checkpoint, sizeof(checkpoint));
+	EEPROM_BUF_flush();  // Then commit whatever is still staged in RAM
+
+	// Hold here until the supply dies; if it comes back, reboot through the checkpoint
+	PowerMonitor_waitForRecovery();
+	wdt_enable(WDTO_15MS);
+	while (1);
+}
+
+// Inspect the checkpoint left by the last power failure and bring the door back to locked
+void restoreCheckpoint(void) {
+	DoorCheckpointType checkpoint;
+
+	if (EEPROM_BUF_read(CHECKPOINT_ADDRESS, (uint8 *)&checkpoint, sizeof(checkpoint)) != SUCCESS ||
+		checkpoint.magic != CHECKPOINT_MAGIC || checkpoint.crc != checkpointCrc(&checkpoint)) {
+		return;  // Clean shutdown (or blank memory): nothing to recover
+	}
+
+	// Only undo the travel that actually happened instead of running a blind full cycle
+	// HMI_ECU is still booting, so no progress events are sent for this travel
+	if (checkpoint.doorState == DOOR_OPENING) {
+		moveDoor(DOOR_CLOSING, ACW, checkpoint.travelTime, FALSE);
+	} else if (checkpoint.doorState == DOOR_OPEN) {
+		moveDoor(DOOR_CLOSING, ACW, Config_get()->doorTravelTime, FALSE);
+	} else if (checkpoint.doorState == DOOR_CLOSING) {
+		moveDoor(DOOR_CLOSING, ACW, Config_get()->doorTravelTime - checkpoint.travelTime, FALSE);
+	}
+
+	// Invalidate the checkpoint so the next boot does not replay it
+	checkpoint.magic = 0;
+	EEPROM_BUF_write(CHECKPOINT_ADDRESS, &checkpoint.magic, 1);
+	EEPROM_BUF_flush();
+}
+
+// CRC over the checkpoint record, excluding the crc field itself
+uint16 checkpointCrc(const DoorCheckpointType *checkpoint) {
+	const uint8 *bytes = (const uint8 *)checkpoint;
+	uint16 crc = 0xFFFF;
+	for (uint8 i = 0; i < sizeof(DoorCheckpointType) - sizeof(uint16); i++) {
+		crc = _crc_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
+
+// Authenticate the link with the stored key, or draw a new one for HMI_ECU to collect with PAIR_COMMAND
+void setupLinkKey(void) {
+	uint8 key[KEYSTORE_KEY_LENGTH];
+
+	if (!Keystore_readKey(key)) {
+		generateLinkKey(key);
+		Keystore_writeKey(key);
+	}
+	// Anyone on the UART could ask for the key: only someone with access to Control_ECU may open the pairing window
+	GPIO_setupPinDirection(PAIR_BUTTON_PORT, PAIR_BUTTON_PIN, PIN_INPUT);
+	GPIO_writePin(PAIR_BUTTON_PORT, PAIR_BUTTON_PIN, LOGIC_HIGH);  // Internal pull-up
+	_delay_us(10);  // Let the input settle through the pull-up
+	g_pairingAllowed = (GPIO_readPin(PAIR_BUTTON_PORT, PAIR_BUTTON_PIN) == LOGIC_LOW) ? TRUE : FALSE;
+	Link_setKey(key, Keystore_isPaired(), LINK_ROLE_SLAVE);  // Plain frames are still accepted until HMI_ECU uses the key
+	Credential_setKey(key);  // Password tags are keyed by the pairing too
+}
+
+// Condition supply noise LSBs and timer jitter through CMAC into a new link key
+void generateLinkKey(uint8 *key) {
+	Cmac_KeyType conditioner;
+	Cmac_StateType state;
+	uint8 zero[KEYSTORE_KEY_LENGTH] = {0};
+
+	Cmac_setKey(&conditioner, zero);  // The conditioner needs no secret, only the mixing
+	for (uint8 half = 0; half < KEYSTORE_KEY_LENGTH / CMAC_TAG_SIZE; half++) {
+		Cmac_start(&state);
+		Cmac_update(&conditioner, &state, &half, 1);  // Keeps the two halves apart
+		for (uint8 i = 0; i < KEY_ENTROPY_SAMPLES; i++) {
+			uint16 noise = ADC_readChannel(POWER_SENSE_CHANNEL);
+			uint32 now = Systick_getMicros();
+			uint8 sample[3] = {(uint8)noise, (uint8)now, (uint8)(now >> 8)};
+			Cmac_update(&conditioner, &state, sample, sizeof(sample));
+		}
+		Cmac_finish(&conditioner, &state, &key[half * CMAC_TAG_SIZE]);
+	}
+}
+
+// Serve a rate negotiation from HMI_ECU and restart the link (first = byte already received, or 0)
+void relink(uint8 first) {
+	Autobaud_serve(first);
+	Link_reset();
+}
+
+// Wait for the next message from HMI_ECU, committing staged EEPROM writes while the door is idle
+uint8 receiveMessage(uint8 *message) {
+	uint8 length;
+
+	if (g_pendingLength != 0) {
+		// Received while waiting for a new password
+		length = g_pendingLength;
+		g_pendingLength = 0;
+		memcpy(message, g_pendingMessage, length);
+		return length;
+	}
+	do {
+		while (!UART_isDataAvailable()) {
+			PROFILE_LOOP_MARK();  // Commands show up as long iterations
+			EEPROM_BUF_service();
+			if (Lockout_service()) {
+				Buzzer_cancel(&g_alarmPattern);  // Lockout over
+			}
+			Idle_sleepUnless(UART_isDataAvailable);  // Woken by the next byte or tick
+		}
+		length = Link_receive(message, LINK_MAX_PAYLOAD, LINK_ACK_TIMEOUT);
+		if (length == LINK_BREAK) {
+			// HMI_ECU lost the link (or restarted): follow it through a new negotiation
+			relink(AUTOBAUD_HELLO);
+			length = 0;
+		}
+	} while (length == 0);
+	return length;
+}
+
+// Publish a door or lockout progress event to HMI_ECU
+void sendDoorEvent(uint8 event, uint8 value) {
+	uint8 message[3] = {DOOR_EVENT_COMMAND, event, value};
+	// Best effort: the door keeps moving if HMI_ECU stops answering, and no more events are tried until it relinks
+	Link_send(message, sizeof(message));
+}
+
+// Run the motor in one direction for a number of seconds while tracking the door state
+DcMotor_StopReason moveDoor(DoorStateType movingState, DcMotor_State direction, uint8 seconds, boolean report) {
+	DcMotor_StopReason reason;
+	uint8 event = (movingState == DOOR_OPENING) ? EVENT_DOOR_OPENING : EVENT_DOOR_CLOSING;
+	uint8 lastReport = 0xFF;
+	uint16 travelTime = seconds * 1000u;  // Whole move in ms, ramps included
+	DcMotor_ProfileType profile = {DOOR_RAMP_SHAPE, DOOR_PEAK_DUTY, Config_get()->doorRampTime, 0};
+
+	if (travelTime > 2 * profile.ramp_time) {
+		profile.cruise_time = travelTime - 2 * profile.ramp_time;
+	} else {
+		profile.ramp_time = travelTime / 2;  // Short recovery moves are all ramp
+	}
+
+	g_travelStart = Systick_getMillis();
+	g_doorState = movingState;
+	g_motorDirection = direction;
+	ADC_startScan();  // Stall detection needs the motor current at the full ADC rate
+	DcMotor_startProfile(direction, &profile);  // Soft-start, cruise and soft-stop in the requested direction
+	// The profile is the expected travel; current sensing ends it at the real end stop, past MOTOR_END_ZONE_PERCENT of it
+	while (!DcMotor_isProfileDone()) {  // The profile stops the motor by itself
+		uint32 elapsed = Systick_elapsedSince(g_travelStart);
+		if (report && elapsed < travelTime && (uint8)(elapsed / DOOR_EVENT_INTERVAL) != lastReport) {
+			// At most one progress event per interval keeps the link load bounded
+			lastReport = (uint8)(elapsed / DOOR_EVENT_INTERVAL);
+			sendDoorEvent(event, (uint8)((elapsed * 100) / travelTime));
+		}
+		Idle_sleepUnless(DcMotor_isProfileDone);  // The profile and current sensing run from interrupts
+	}
+	reason = DcMotor_getStopReason();
+	DcMotor_Rotate(STOP, 100);  // Make sure the motor is stopped
+	g_motorDirection = STOP;
+	ADC_startSlowScan();  // Only the supply matters again
+	if (reason == MOTOR_STOP_STALL) {
+		// Blocked part way: the door is neither open nor locked
+		g_doorState = (movingState == DOOR_OPENING) ? DOOR_OPEN : DOOR_CLOSING;
+		return reason;
+	}
+	g_doorState = (movingState == DOOR_OPENING) ? DOOR_OPEN : DOOR_LOCKED;
+	if (report) {
+		sendDoorEvent(event, 100);
+	}
+	return reason;
 }
 
-// Unlock the door by rotating the DC motor for 15 seconds
+// Unlock the door by rotating the DC motor for a full travel
 void unlockDoor() {
-	setupTimer1();  // Start Timer1
-	g_tick = 0;
-	DcMotor_Rotate(CW, 100);  // Rotate motor in the clockwise direction (open the door)
-	while (g_tick < 15);  // Wait for 15 seconds (keep motor running for 15 seconds)
-	DcMotor_Rotate(STOP, 100);  // Stop the motor after 15 seconds
-	g_tick = 0;
-	Timer1Stop();  // Stop Timer1
+	uint32 lastEvent;
+
+	moveDoor(DOOR_OPENING, CW, Config_get()->doorTravelTime, TRUE);  // Rotate motor in the clockwise direction (open the door)
+
+	lastEvent = Systick_getMillis() - 1000;
 	while (PIR_getState()) {
-		// While PIR sensor detects motion, send wait message to HMI_ECU
-		UART_sendByte(WAIT_MESSAGE_COMMAND);
+		// While PIR sensor detects motion, tell HMI_ECU once per second that the door is held
+		if (Systick_elapsedSince(lastEvent) >= 1000) {
+			sendDoorEvent(EVENT_DOOR_HOLDING, 0);
+			lastEvent = Systick_getMillis();  // After the send: a slow one must not be caught up with a burst
+		}
+		Idle_sleep();  // PIR is polled once per tick
 	}
-	UART_sendByte(0);  // Indicate that the motion detection has stopped (PIR sensor did not detect motion)
+
 	lockDoor();  // Lock the door after the motion detection has stopped
+	sendDoorEvent(EVENT_DOOR_LOCKED, 0);  // Door cycle is over
 }
 
-// Lock the door by rotating the DC motor in the opposite direction for 15 seconds
+// Lock the door by rotating the DC motor in the opposite direction for a full travel
 void lockDoor() {
-	setupTimer1();  // Start Timer1
-	g_tick = 0;
-	DcMotor_Rotate(ACW, 100);  // Rotate motor in the anticlockwise direction (lock the door)
-	while (g_tick < 15);  // Wait for 15 seconds (keep motor running for 15 seconds to lock the door)
-	DcMotor_Rotate(STOP, 100);  // Stop the motor after 15 seconds
-	Timer1Stop();  // Stop Timer1
+	uint8 retries = (uint8)Config_get()->stallRetries;
+	uint8 travelTime = (uint8)Config_get()->doorTravelTime;
+
+	// Rotate motor in the anticlockwise direction (lock the door)
+	while (moveDoor(DOOR_CLOSING, ACW, travelTime, TRUE) == MOTOR_STOP_STALL && retries--) {
+		// Something blocks the door: open it again before the next attempt to close
+		moveDoor(DOOR_OPENING, CW, travelTime, TRUE);
+	}
 }
 
-// Receive and verify the password from HMI_ECU for password creation
-void receiveAndVerifyPasswords() {
-	uint8 receivedPassword1[PASSWORD_LENGTH], receivedPassword2[PASSWORD_LENGTH];
+// Receive a new password from HMI_ECU and store its tag, HMI_ECU already compared the two entries
+void receiveNewPassword() {
+	uint8 message[LINK_MAX_PAYLOAD];
+	uint8 tag[CREDENTIAL_TAG_SIZE];
+	uint8 length;
+	uint8 verdict;
+	uint8 savedLength;
+
+	do {
+		// Wait for START_COMMUNICATION, length, digits
+		while ((length = receiveMessage(message)) < 2 || message[0] != START_COMMUNICATION || length != message[1] + 2) {
+			if (message[0] == PAIR_COMMAND || message[0] == LOCKOUT_STATUS_COMMAND || message[0] == CONFIG_GET_COMMAND ||
+				message[0] == PASSWORD_STATUS_COMMAND) {
+				// A new HMI_ECU collects the key and the settings and asks for a password before anything else, a locked out one polls the time left
+				Command_dispatch(message, length);
+				continue;
+			}
+			savedLength = readCredentialFromEEPROM(tag);
+			if (savedLength >= PASSWORD_MIN_LENGTH && savedLength <= PASSWORD_MAX_LENGTH) {
+				// HMI_ECU is back at its menu (it missed our reply or gave up): keep the stored password, run the command from the main loop
+				memcpy(g_pendingMessage, message, length);
+				g_pendingLength = length;
+				return;
+			}
+		}
+
+		if (Lockout_isActive()) {
+			verdict = PASSWORD_LOCKED;  // A reset must not be a way around the lockout
+		} else if (message[1] >= PASSWORD_MIN_LENGTH && message[1] <= PASSWORD_MAX_LENGTH) {
+			Credential_compute(&message[2], message[1], tag);
+			saveCredentialToEEPROM(tag, message[1]);  // If the length is allowed, save the password tag to EEPROM
+			verdict = 1;
+			Buzzer_play(&g_chirpPattern);
+		} else {
+			verdict = 0;
+		}
+		// If the verdict is lost, or the password was refused, HMI_ECU sends a password again
+	} while (!Link_send(&verdict, 1) || verdict != 1);  // 1 = stored, 0 = length refused, or PASSWORD_LOCKED
+}
 
-	// Wait for the start communication signal
-	while (UART_recieveByte() != START_COMMUNICATION);
+// Check the password streamed with DIGIT_COMMAND before an open door or change password command (args: digit count), reply 1 if it matches
+uint8 verifyPasswordCommand(const uint8 *args) {
+	uint8 savedTag[CREDENTIAL_TAG_SIZE];
+	uint8 savedLength = readCredentialFromEEPROM(savedTag);  // Read the saved password tag from EEPROM
 
-	// Receive the first password
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		receivedPassword1[i] = UART_recieveByte();
+	// The digits are already absorbed: only the last block and a constant-time compare are left, whatever the length
+	boolean match = Credential_verify(args[0], savedTag) && args[0] == savedLength;
+	if (Lockout_isActive()) {
+		return PASSWORD_LOCKED;  // Not even a right password opens during a lockout
 	}
+	if (match) {
+		Lockout_recordSuccess();  // Reset failures and escalation
+		return 1;  // Success signal to HMI_ECU
+	}
+	return Lockout_recordFailure() ? PASSWORD_LOCKED : 0;  // Failure signal to HMI_ECU
+}
+
+// Absorb one password digit as the user types it (args: position, digit), the link ACK is enough
+uint8 digitCommand(const uint8 *args) {
+	Credential_absorb(args[0], args[1]);
+	return COMMAND_NO_REPLY;
+}
+
+// Open the door once HMI_ECU knows the password was right
+void openDoorComplete(uint8 reply) {
+	signalVerdict(reply);
+	if (reply == 1) unlockDoor();
+}
 
-	// Wait for the second start communication signal
-	while (UART_recieveByte() != START_COMMUNICATION);
+// Take the new password once HMI_ECU knows the old one was right
+void changePasswordComplete(uint8 reply) {
+	signalVerdict(reply);
+	if (reply == 1) receiveNewPassword();
+}
 
-	// Receive the second password
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		receivedPassword2[i] = UART_recieveByte();
+// Accept setting changes for a while once HMI_ECU knows the password was right
+void settingsComplete(uint8 reply) {
+	signalVerdict(reply);
+	if (reply == 1) {
+		g_settingsUnlocked = TRUE;
+		g_settingsTime = Systick_getMillis();
 	}
+}
 
-	// Compare the two received passwords to check if they match
-	if (memcmp(receivedPassword1, receivedPassword2, PASSWORD_LENGTH) == 0) {
-		savePasswordToEEPROM(receivedPassword1);  // If passwords match, save the password to EEPROM
-		UART_sendByte(1);  // Send success signal to HMI_ECU
-	} else {
-		UART_sendByte(0);  // Send failure signal to HMI_ECU
+// Sound a password verdict without waiting for the pattern to finish
+void signalVerdict(uint8 reply) {
+	if (reply == 1) Buzzer_play(&g_chirpPattern);
+	else if (reply == PASSWORD_LOCKED) Buzzer_play(&g_alarmPattern);  // For the whole lockout, cancelled from receiveMessage
+	else Buzzer_play(&g_errorPattern);
+}
+
+#if PROFILE_ENABLE
+// Send the profiler report as link frames of DIAG_CHUNK_LENGTH bytes, they are the reply
+uint8 diagCommand(const uint8 *args) {
+	uint8 report[PROFILE_REPORT_LENGTH];
+	uint8 message[LINK_MAX_PAYLOAD];
+	uint8 offset, size;
+
+	Profile_getReport(report);  // CPU load and ISR timing, layout in profile.h
+	for (offset = 0; offset < PROFILE_REPORT_LENGTH; offset += size) {
+		size = (PROFILE_REPORT_LENGTH - offset < DIAG_CHUNK_LENGTH) ? PROFILE_REPORT_LENGTH - offset : DIAG_CHUNK_LENGTH;
+		message[0] = DIAG_COMMAND;
+		message[1] = offset;
+		memcpy(&message[2], &report[offset], size);
+		if (!Link_send(message, size + 2)) {
+			break;  // HMI_ECU gave up, the rest of the report is lost
+		}
 	}
+	return COMMAND_NO_REPLY;
 }
+#endif
 
-// Receive and verify the entered password for the operation (open door or change password)
-void receiveAndVerifyPasswordForOperation(uint8 command) {
-	readPasswordFromEEPROM(savedPassword);  // Read the saved password from EEPROM
+// Send the UART receive errors and the link counters, the report is its own reply
+uint8 linkStatusCommand(const uint8 *args) {
+	UART_ErrorStatsType errors;
+	Link_StatsType link;
+	uint8 message[LINK_STATUS_LENGTH];
 
-	// Wait for the start communication signal
-	while (UART_recieveByte() != START_COMMUNICATION);
+	UART_getErrorStats(&errors);
+	Link_getStats(&link);
+	uint16 counters[(LINK_STATUS_LENGTH - 1) / 2] = {
+		errors.framing, errors.overrun, errors.parity, errors.overflow,
+		link.retransmits, link.failures, link.badFrames
+	};
 
-	// Receive the entered password
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		enteredPassword[i] = UART_recieveByte();
+	message[0] = LINK_STATUS_COMMAND;
+	for (uint8 i = 0; i < (LINK_STATUS_LENGTH - 1) / 2; i++) {
+		message[2 * i + 1] = (uint8)counters[i];
+		message[2 * i + 2] = (uint8)(counters[i] >> 8);
 	}
+	Link_send(message, sizeof(message));
+	return COMMAND_NO_REPLY;
+}
 
-	// Compare the entered password with the saved password
-	if (memcmp(savedPassword, enteredPassword, PASSWORD_LENGTH) == 0) {
-		UART_sendByte(1);  // If password is correct, send success signal to HMI_ECU
-		attempts = 0;  // Reset attempts counter
-		if (command == COMMAND_OPEN_DOOR) unlockDoor();  // If command is to open door, unlock the door
-		else if (command == COMMAND_CHANGE_PASSWORD) receiveAndVerifyPasswords();  // If command is to change password, prompt for new password
-	} else {
-		UART_sendByte(0);  // If password is incorrect, send failure signal to HMI_ECU
-		attempts++;  // Increment attempts counter
-		handleFailedAttempts();  // Handle the failed attempts
+// Send the lockout time left and the attempts left before the next lockout, the status is its own reply
+uint8 lockoutStatusCommand(const uint8 *args) {
+	uint16 remaining = Lockout_getRemaining();
+	uint8 message[LOCKOUT_STATUS_LENGTH] = {
+		LOCKOUT_STATUS_COMMAND, (uint8)remaining, (uint8)(remaining >> 8), Lockout_getAttemptsLeft()
+	};
+
+	Link_send(message, sizeof(message));
+	return COMMAND_NO_REPLY;
+}
+
+// Tell HMI_ECU whether a password is stored, so a reset of HMI_ECU alone does not ask for a new one
+uint8 passwordStatusCommand(const uint8 *args) {
+	uint8 tag[CREDENTIAL_TAG_SIZE];
+	uint8 savedLength = readCredentialFromEEPROM(tag);
+
+	return (savedLength >= PASSWORD_MIN_LENGTH && savedLength <= PASSWORD_MAX_LENGTH) ? 1 : 0;
+}
+
+// Send the installer settings, they are their own reply
+uint8 configGetCommand(const uint8 *args) {
+	const uint16 *fields = (const uint16 *)Config_get();
+	uint8 message[CONFIG_GET_LENGTH];
+
+	message[0] = CONFIG_GET_COMMAND;
+	for (uint8 i = 0; i < CONFIG_FIELDS; i++) {
+		message[2 * i + 1] = (uint8)fields[i];
+		message[2 * i + 2] = (uint8)(fields[i] >> 8);
 	}
+	Link_send(message, sizeof(message));
+	return COMMAND_NO_REPLY;
 }
 
-// Save the password to EEPROM for future use
-void savePasswordToEEPROM(uint8 *password) {
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		EEPROM_writeByte(EEPROM_ADDRESS + i, password[i]);  // Write each byte of the password to EEPROM
-		_delay_ms(10);  // Short delay for EEPROM write stability
+// Change one installer setting (args: field, value low, value high), reply 1 if it is unlocked, in range and stored
+uint8 configSetCommand(const uint8 *args) {
+	if (!g_settingsUnlocked || Systick_elapsedSince(g_settingsTime) > SETTINGS_UNLOCK_TIME) {
+		g_settingsUnlocked = FALSE;
+		return 0;  // Settings only change right after the password was given
 	}
+	g_settingsTime = Systick_getMillis();
+	if (!Config_set(args[0], args[1] | (args[2] << 8))) {
+		return 0;
+	}
+	if (args[0] == CONFIG_ATTEMPTS_LIMIT || args[0] == CONFIG_LOCKOUT_TIME) {
+		Lockout_PolicyType policy;
+		getLockoutPolicy(&policy);
+		Lockout_setPolicy(&policy);  // From the next lockout on
+	}
+	return 1;
 }
 
-// Read the saved password from EEPROM
-void readPasswordFromEEPROM(uint8 *password) {
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		EEPROM_readByte(EEPROM_ADDRESS + i, &password[i]);  // Read each byte of the saved password from EEPROM
-		_delay_ms(10);  // Short delay for EEPROM read stability
+// Lockout policy from the installer settings
+void getLockoutPolicy(Lockout_PolicyType *policy) {
+	policy->attemptsLimit = (uint8)Config_get()->attemptsLimit;
+	for (uint8 level = 0; level < LOCKOUT_LEVELS; level++) {
+		policy->seconds[level] = Config_get()->lockoutTime * pgm_read_byte(&g_lockoutScale[level]);
 	}
 }
 
-// Handle failed password attempts (e.g., trigger a buzzer if the limit is exceeded)
-void handleFailedAttempts() {
-	if (attempts >= ATTEMPTS_LIMIT) {
-		setupTimer1();  // Start Timer1 for delay
-		g_tick = 0;
-		Buzzer_on();  // Turn on buzzer to alert user about failed attempts
-		while (g_tick < 60);  // Keep buzzer on for 1 minute (60 seconds)
-		Buzzer_off();  // Turn off the buzzer after 1 minute
-		attempts = 0;  // Reset failed attempts counter
-		Timer1Stop();  // Stop Timer1
+// Send the link key to a new HMI_ECU, the key is its own reply; refused (0) without the pairing button, after the window or once paired
+uint8 pairCommand(const uint8 *args) {
+	uint8 key[KEYSTORE_KEY_LENGTH];
+
+	if (!g_pairingAllowed || Systick_getMillis() > PAIR_WINDOW_TIME || Keystore_isPaired() || !Keystore_readKey(key)) {
+		return 0;
 	}
+	Link_send(key, sizeof(key));  // Still plain: this is how HMI_ECU learns the key
+	return COMMAND_NO_REPLY;
+}
+
+#if UART_FAULT_ENABLE
+// Link benchmark exchange: same frames as an open door request and its verdict, without moving the door
+uint8 benchCommand(const uint8 *args) {
+	return 1;
+}
+#endif
+
+// Save the password tag and length to EEPROM for future use
+void saveCredentialToEEPROM(const uint8 *tag, uint8 length) {
+	// Staged in RAM and committed by the idle loop, so the reply to HMI_ECU is not delayed
+	EEPROM_BUF_write(EEPROM_ADDRESS, tag, CREDENTIAL_TAG_SIZE);
+	EEPROM_BUF_write(EEPROM_ADDRESS + CREDENTIAL_TAG_SIZE, &length, 1);
+}
+
+// Read the saved password tag from EEPROM, returns the password length
+uint8 readCredentialFromEEPROM(uint8 *tag) {
+	uint8 length = 0;
+	// Reads through the write-back buffer, so a password not committed yet is still seen
+	EEPROM_BUF_read(EEPROM_ADDRESS, tag, CREDENTIAL_TAG_SIZE);
+	EEPROM_BUF_read(EEPROM_ADDRESS + CREDENTIAL_TAG_SIZE, &length, 1);
+	return length;
 }
@@ -5,42 +5,105 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../Control_ECU.c \
+../adc.c \
+../autobaud.c \
 ../buzzer.c \
+../cmac.c \
+../command.c \
+../config.c \
+../credential.c \
+../eeprom_buffer.c \
 ../external_eeprom.c \
 ../gpio.c \
+../idle.c \
+../keystore.c \
+../link.c \
+../lockout.c \
 ../motor.c \
 ../pir.c \
+../power_monitor.c \
+../profile.c \
 ../pwm.c \
+../speck.c \
+../stack_monitor.c \
+../systick.c \
 ../timer.c \
 ../twi.c \
 ../uart.c 
 
 OBJS += \
 ./Control_ECU.o \
+./adc.o \
+./autobaud.o \
 ./buzzer.o \
+./cmac.o \
+./command.o \
+./config.o \
+./credential.o \
+./eeprom_buffer.o \
 ./external_eeprom.o \
 ./gpio.o \
+./idle.o \
+./keystore.o \
+./link.o \
+./lockout.o \
 ./motor.o \
 ./pir.o \
+./power_monitor.o \
+./profile.o \
 ./pwm.o \
+./speck.o \
+./stack_monitor.o \
+./systick.o \
 ./timer.o \
 ./twi.o \
 ./uart.o 
 
 C_DEPS += \
 ./Control_ECU.d \
+./adc.d \
+./autobaud.d \
 ./buzzer.d \
+./cmac.d \
+./command.d \
+./config.d \
+./credential.d \
+./eeprom_buffer.d \
 ./external_eeprom.d \
 ./gpio.d \
+./idle.d \
+./keystore.d \
+./link.d \
+./lockout.d \
 ./motor.d \
 ./pir.d \
+./power_monitor.d \
+./profile.d \
 ./pwm.d \
+./speck.d \
+./stack_monitor.d \
+./systick.d \
 ./timer.d \
 ./twi.d \
 ./uart.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
+# The link cipher and MAC run on every frame: always optimized, whatever the configuration
+./cmac.o: ../cmac.c subdir.mk
+	@echo 'Building file: $<'
+	@echo 'Invoking: AVR Compiler'
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+./speck.o: ../speck.c subdir.mk
+	@echo 'Building file: $<'
+	@echo 'Invoking: AVR Compiler'
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 %.o: ../%.c subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: AVR Compiler'
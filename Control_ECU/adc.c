@@ -0,0 +1,175 @@
+ /******************************************************************************
+ *
+ * Module: ADC
+ *
+ * File Name: adc.c
+ *
+ * Description: Source file for the interrupt driven ADC driver
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "adc.h"
+#include "common_macros.h"
+#include "profile.h"
+#include "timer.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/* Internal 2.56V reference with external capacitor at AREF */
+#define ADC_REF_BITS ((1 << REFS1) | (1 << REFS0))
+
+/* Per channel result callbacks, a NULL_PTR entry is skipped by the scan */
+static void (*g_adcCallBackPtr[ADC_NUM_OF_CHANNELS])(uint16);
+
+/*
+ * In free running mode the next conversion starts as soon as the previous one
+ * completes, before the interrupt runs. A multiplexer change made in the ISR
+ * therefore applies to the conversion after the running one.
+ */
+static volatile uint8 g_runningChannel;  // Channel of the conversion in progress
+static volatile uint8 g_queuedChannel;   // Channel written to ADMUX for the one after
+
+/* Slow scan: one conversion per system tick, no ADC interrupt */
+static volatile boolean g_slowScan = FALSE;
+
+static uint8 ADC_nextChannel(uint8 channel)
+{
+	uint8 i;
+
+	for (i = 0; i < ADC_NUM_OF_CHANNELS; i++)
+	{
+		channel = (channel + 1) & (ADC_NUM_OF_CHANNELS - 1);
+		if (g_adcCallBackPtr[channel] != NULL_PTR)
+		{
+			break;
+		}
+	}
+	return channel;
+}
+
+/* Stop any scan and let a conversion in progress finish */
+static void ADC_stopScan(void)
+{
+	g_slowScan = FALSE;
+	ADCSRA &= ~((1 << ADATE) | (1 << ADIE));
+	while (BIT_IS_SET(ADCSRA,ADSC));
+	ADCSRA |= (1 << ADIF);
+}
+
+/* Called from the Timer1 compare interrupt once per millisecond, next to the system tick */
+static void ADC_tick(void)
+{
+	uint16 value;
+	uint8 done;
+
+	if (!g_slowScan || BIT_IS_SET(ADCSRA,ADSC))
+	{
+		return;
+	}
+
+	/* The conversion started on the last tick is over: queue the next channel before handing out the result */
+	value = ADC;
+	done = g_runningChannel;
+	g_runningChannel = ADC_nextChannel(done);
+	ADMUX = ADC_REF_BITS | g_runningChannel;
+	ADCSRA |= (1 << ADSC) | (1 << ADIF);
+
+	if (g_adcCallBackPtr[done] != NULL_PTR)
+	{
+		(*g_adcCallBackPtr[done])(value);
+	}
+}
+
+void ADC_init(void)
+{
+	ADMUX = ADC_REF_BITS;
+
+	/* Enable the ADC with F_CPU/128 = 62.5kHz ADC clock at 8MHz */
+	ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+
+	/* Free running trigger source (ADTS = 000) */
+	SFIOR &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));
+
+	/* The slow scan runs on the system tick; registered here so a full Timer1 shows up at boot (Timer_hasConflict) */
+	Timer_addCallBack(ADC_tick, TIMER_1);
+}
+
+void ADC_setCallBack(void(*a_ptr)(uint16), uint8 channel)
+{
+	if (channel < ADC_NUM_OF_CHANNELS)
+	{
+		g_adcCallBackPtr[channel] = a_ptr;
+	}
+}
+
+void ADC_startScan(void)
+{
+	uint8 first = ADC_nextChannel(ADC_NUM_OF_CHANNELS - 1);
+
+	if (g_adcCallBackPtr[first] == NULL_PTR)
+	{
+		return;  /* Nothing registered */
+	}
+
+	ADC_stopScan();
+
+	/*
+	 * The multiplexer is only latched on the next ADC clock edge, so the
+	 * first two conversions both use the first channel; the ISR takes over
+	 * the round-robin from there.
+	 */
+	ADMUX = ADC_REF_BITS | first;
+	g_runningChannel = first;
+	g_queuedChannel = first;
+	ADCSRA |= (1 << ADATE) | (1 << ADIE) | (1 << ADIF) | (1 << ADSC);
+}
+
+void ADC_startSlowScan(void)
+{
+	uint8 first = ADC_nextChannel(ADC_NUM_OF_CHANNELS - 1);
+
+	ADC_stopScan();
+	if (g_adcCallBackPtr[first] == NULL_PTR)
+	{
+		return;  /* Nothing registered */
+	}
+
+	/* Results are picked up by the tick, so an idle CPU only wakes up for the tick itself */
+	ADMUX = ADC_REF_BITS | first;
+	g_runningChannel = first;
+	ADCSRA |= (1 << ADSC);
+	g_slowScan = TRUE;
+}
+
+uint16 ADC_readChannel(uint8 channel)
+{
+	/* Leave the scan and let a conversion in progress finish */
+	ADC_stopScan();
+
+	ADMUX = ADC_REF_BITS | (channel & (ADC_NUM_OF_CHANNELS - 1));
+	ADCSRA |= (1 << ADSC);
+	while (BIT_IS_SET(ADCSRA,ADSC));
+	ADCSRA |= (1 << ADIF);
+
+	return ADC;
+}
+
+/* ISR for the ADC conversion complete */
+ISR(ADC_vect)
+{
+	PROFILE_ISR_ENTER();
+	uint16 value = ADC;
+	uint8 done = g_runningChannel;
+
+	g_runningChannel = g_queuedChannel;
+	g_queuedChannel = ADC_nextChannel(g_queuedChannel);
+	ADMUX = ADC_REF_BITS | g_queuedChannel;
+
+	if (g_adcCallBackPtr[done] != NULL_PTR)
+	{
+		(*g_adcCallBackPtr[done])(value);
+	}
+	PROFILE_ISR_EXIT(PROFILE_ISR_ADC);
+}
@@ -0,0 +1,73 @@
+ /******************************************************************************
+ *
+ * Module: ADC
+ *
+ * File Name: adc.h
+ *
+ * Description: Header file for the interrupt driven ADC driver. Channels with
+ *              a registered callback are converted round-robin in free running
+ *              mode and every result is handed to its callback from the ADC
+ *              interrupt.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef ADC_H_
+#define ADC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define ADC_NUM_OF_CHANNELS 8
+
+/* All channels are measured against the internal 2.56V reference */
+#define ADC_REF_MILLIVOLTS  2560
+#define ADC_MAX_VALUE       1023
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Select the reference and the ADC clock (F_CPU/128). Does not start converting.
+ */
+void ADC_init(void);
+
+/*
+ * Description :
+ * Register the function receiving every result of a channel in the scan,
+ * or pass NULL_PTR to remove the channel from the scan.
+ */
+void ADC_setCallBack(void(*a_ptr)(uint16), uint8 channel);
+
+/*
+ * Description :
+ * Start free running, interrupt driven conversions over the registered
+ * channels, one every 208 us. Meant for while the motor runs: the interrupt
+ * wakes the CPU about five times per millisecond.
+ */
+void ADC_startScan(void);
+
+/*
+ * Description :
+ * Scan the registered channels at one conversion per system tick, the
+ * result being handled on the next tick (from the Timer1 interrupt). No ADC
+ * interrupt is used, so the idle CPU only wakes up for the tick. Needs
+ * Systick_init(); the tick callback is added to Timer1 by ADC_init().
+ */
+void ADC_startSlowScan(void);
+
+/*
+ * Description :
+ * Stop the scan and do a single polled conversion of a channel. Usable with
+ * interrupts disabled; call ADC_startScan() or ADC_startSlowScan() again to
+ * resume scanning.
+ */
+uint16 ADC_readChannel(uint8 channel);
+
+#endif /* ADC_H_ */
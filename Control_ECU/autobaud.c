@@ -0,0 +1,221 @@
+ /******************************************************************************
+ *
+ * Module: Autobaud
+ *
+ * File Name: autobaud.c
+ *
+ * Description: Source file for the link rate negotiation
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "autobaud.h"
+#include "uart.h"
+#include "idle.h"
+#include "systick.h"
+#include <avr/pgmspace.h>
+
+/* Candidate rates, fastest first; all are exact or within 0.2% at 8MHz with U2X */
+static const uint32 g_candidates[] PROGMEM = {250000, 76800, 38400};
+#define AUTOBAUD_NUM_OF_CANDIDATES (sizeof(g_candidates) / sizeof(g_candidates[0]))
+
+/* Loopback pattern: alternating bits and edges, none of them a protocol byte */
+static const uint8 g_testPattern[] PROGMEM = {0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x5A, 0xA5};
+
+#define AUTOBAUD_CONFIRM_RETRIES 3
+
+/* Rate of the last negotiation, the one the slave falls back to */
+static uint32 g_rate = AUTOBAUD_BASE_RATE;
+
+static boolean Autobaud_isUsable(uint32 rate)
+{
+	sint16 error = UART_getBaudError(rate);
+	return (error <= UART_MAX_BAUD_ERROR && error >= -UART_MAX_BAUD_ERROR) ? TRUE : FALSE;
+}
+
+static boolean Autobaud_expect(uint8 expected)
+{
+	uint8 data;
+	return (UART_receiveByteTimeout(&data, AUTOBAUD_REPLY_TIMEOUT) && data == expected) ? TRUE : FALSE;
+}
+
+/* Slave: echo every byte at the candidate rate until CONFIRM, FALSE if the window ends first */
+static boolean Autobaud_echoUntilConfirm(void)
+{
+	uint32 start = Systick_getMillis();
+	uint8 data;
+
+	while (Systick_elapsedSince(start) < AUTOBAUD_TEST_WINDOW)
+	{
+		if (UART_receiveByteTimeout(&data, AUTOBAUD_REPLY_TIMEOUT))
+		{
+			UART_sendByte(data);
+			if (data == AUTOBAUD_CONFIRM)
+			{
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
+
+/* Slave: echo repeated CONFIRMs for a while, in case the master missed ours */
+static void Autobaud_linger(void)
+{
+	uint8 data;
+
+	while (UART_receiveByteTimeout(&data, 2 * AUTOBAUD_REPLY_TIMEOUT))
+	{
+		if (data == AUTOBAUD_CONFIRM)
+		{
+			UART_sendByte(AUTOBAUD_CONFIRM);
+		}
+	}
+}
+
+/* Master: send CONFIRM until it is echoed */
+static boolean Autobaud_confirm(void)
+{
+	uint8 i;
+
+	for (i = 0; i < AUTOBAUD_CONFIRM_RETRIES; i++)
+	{
+		UART_sendByte(AUTOBAUD_CONFIRM);
+		if (Autobaud_expect(AUTOBAUD_CONFIRM))
+		{
+			/* Let the slave leave its linger before anything else is sent */
+			Idle_delayMs(2 * AUTOBAUD_REPLY_TIMEOUT + AUTOBAUD_SETTLE_TIME);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+uint32 Autobaud_negotiate(void)
+{
+	uint8 i;
+	uint8 j;
+	uint32 rate;
+	boolean passed;
+
+	/*
+	 * The slave may still be busy after reset, or still at the rate of a
+	 * link we lost: call at the base rate and at every candidate until it
+	 * answers. The proposals below work from whichever rate it answers at.
+	 */
+	i = 0;
+	while (1)
+	{
+		UART_setBaudRate((i == 0) ? AUTOBAUD_BASE_RATE : pgm_read_dword(&g_candidates[i - 1]));
+		UART_flushRx();
+		for (j = 0; j < AUTOBAUD_HELLO_REPEAT; j++)
+		{
+			UART_sendByte(AUTOBAUD_HELLO);
+		}
+		if (Autobaud_expect(AUTOBAUD_HELLO))
+		{
+			break;
+		}
+		i = (i + 1) % (AUTOBAUD_NUM_OF_CANDIDATES + 1);
+	}
+	Idle_delayMs(AUTOBAUD_REPLY_TIMEOUT);  /* Echoes of queued HELLOs */
+
+	for (i = 0; i < AUTOBAUD_NUM_OF_CANDIDATES; i++)
+	{
+		rate = pgm_read_dword(&g_candidates[i]);
+		if (!Autobaud_isUsable(rate))
+		{
+			continue;
+		}
+
+		UART_flushRx();
+		UART_sendByte(AUTOBAUD_PROPOSE);
+		UART_sendByte(i);
+		if (!Autobaud_expect(AUTOBAUD_PROPOSE))
+		{
+			continue;  /* Refused, still at the base rate */
+		}
+		UART_setBaudRate(rate);
+		Idle_delayMs(AUTOBAUD_SETTLE_TIME);
+		UART_flushRx();
+
+		passed = TRUE;
+		for (j = 0; j < sizeof(g_testPattern) && passed; j++)
+		{
+			UART_sendByte(pgm_read_byte(&g_testPattern[j]));
+			passed = Autobaud_expect(pgm_read_byte(&g_testPattern[j]));
+		}
+		if (passed && Autobaud_confirm())
+		{
+			g_rate = rate;
+			return rate;
+		}
+
+		/* Back to the base rate; the slave gets there when its test window ends */
+		UART_setBaudRate(AUTOBAUD_BASE_RATE);
+		Idle_delayMs(AUTOBAUD_TEST_WINDOW);
+	}
+
+	UART_flushRx();
+	Autobaud_confirm();  /* Stay at the base rate */
+	g_rate = AUTOBAUD_BASE_RATE;
+	return AUTOBAUD_BASE_RATE;
+}
+
+uint32 Autobaud_serve(uint8 first)
+{
+	uint8 data = first;
+	uint8 index;
+	uint32 rate;
+	uint32 lastCall = Systick_getMillis();  /* Last protocol byte from the master */
+	uint32 elapsed;
+
+	while (1)
+	{
+		/* A master reset or unplugged mid-negotiation must not hold the caller forever, noise included */
+		elapsed = Systick_elapsedSince(lastCall);
+		if (data == 0 && (elapsed >= AUTOBAUD_SERVE_TIMEOUT ||
+			!UART_receiveByteTimeout(&data, (uint16)(AUTOBAUD_SERVE_TIMEOUT - elapsed))))
+		{
+			UART_setBaudRate(g_rate);
+			UART_flushRx();
+			return g_rate;
+		}
+		if (data == AUTOBAUD_HELLO || data == AUTOBAUD_PROPOSE)
+		{
+			lastCall = Systick_getMillis();
+		}
+
+		if (data == AUTOBAUD_HELLO)
+		{
+			UART_sendByte(AUTOBAUD_HELLO);
+		}
+		else if (data == AUTOBAUD_PROPOSE)
+		{
+			if (UART_receiveByteTimeout(&index, AUTOBAUD_REPLY_TIMEOUT) && index < AUTOBAUD_NUM_OF_CANDIDATES &&
+				Autobaud_isUsable(rate = pgm_read_dword(&g_candidates[index])))
+			{
+				UART_sendByte(AUTOBAUD_PROPOSE);
+				UART_setBaudRate(rate);  /* After the echo has left */
+				UART_flushRx();
+				if (Autobaud_echoUntilConfirm())
+				{
+					Autobaud_linger();
+					g_rate = rate;
+					return rate;
+				}
+				UART_setBaudRate(AUTOBAUD_BASE_RATE);
+				UART_flushRx();
+			}
+		}
+		else if (data == AUTOBAUD_CONFIRM)
+		{
+			UART_sendByte(AUTOBAUD_CONFIRM);
+			Autobaud_linger();
+			g_rate = AUTOBAUD_BASE_RATE;
+			return AUTOBAUD_BASE_RATE;
+		}
+		data = 0;
+	}
+}
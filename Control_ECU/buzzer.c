@@ -5,20 +5,115 @@
  *  Author: Mohamed Bahaa
  */ 
 #include "buzzer.h"
+#include "timer.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+// Sequencer state, shared with the Timer1 compare interrupt
+static const Buzzer_PatternType *volatile g_pattern = NULL_PTR;
+static volatile uint16 g_stepLeft = 0;  // ms left in the current step
+static volatile uint8 g_step = 0;
+static volatile uint8 g_playsLeft = 0;
+
+// Drive the pin for a step: even steps sound, odd steps are silent
+static void Buzzer_setStep(uint8 step) {
+	if (step & 1) BUZZER_PORT &= ~(1 << BUZZER_PIN);
+	else BUZZER_PORT |= (1 << BUZZER_PIN);
+}
+
+// Length of a pattern step in ms, 0 past the last step
+static uint16 Buzzer_stepLength(const Buzzer_PatternType *pattern, uint8 step) {
+	if (step >= BUZZER_MAX_STEPS) return 0;
+	return (uint16)pgm_read_byte(&pattern->steps[step]) * BUZZER_STEP_MS;
+}
+
+// Called from the Timer1 compare interrupt once per millisecond, next to the system tick
+static void Buzzer_tick(void) {
+	const Buzzer_PatternType *pattern = g_pattern;
+
+	if (pattern == NULL_PTR || --g_stepLeft != 0) return;
+
+	g_step++;
+	g_stepLeft = Buzzer_stepLength(pattern, g_step);
+	if (g_stepLeft == 0) {
+		// End of the steps: play them again, or stop
+		if (g_playsLeft != BUZZER_REPEAT_FOREVER && --g_playsLeft == 0) {
+			g_pattern = NULL_PTR;
+			BUZZER_PORT &= ~(1 << BUZZER_PIN);
+			return;
+		}
+		g_step = 0;
+		g_stepLeft = Buzzer_stepLength(pattern, 0);
+	}
+	Buzzer_setStep(g_step);
+}
+
+// Stop the sequencer, the caller sets the pin
+static void Buzzer_stop(void) {
+	uint8 sreg = SREG;
+
+	cli();
+	g_pattern = NULL_PTR;
+	SREG = sreg;
+}
 
 void Buzzer_init(void) {
 	// Set the buzzer pin as an output
 	BUZZER_DDR |= (1 << BUZZER_PIN);
 	// Turn off the buzzer initially
 	BUZZER_PORT &= ~(1 << BUZZER_PIN);
+	// Patterns advance on the system tick, which owns Timer1
+	if (!Timer_addCallBack(Buzzer_tick, TIMER_1)) {
+		// No pattern could ever play: sound a steady tone, Timer_hasConflict() stops the boot
+		BUZZER_PORT |= (1 << BUZZER_PIN);
+	}
 }
 
 void Buzzer_on(void) {
 	// Activate the buzzer
+	Buzzer_stop();
 	BUZZER_PORT |= (1 << BUZZER_PIN);
 }
 
 void Buzzer_off(void) {
 	// Deactivate the buzzer
+	Buzzer_stop();
 	BUZZER_PORT &= ~(1 << BUZZER_PIN);
+}
+boolean Buzzer_play(const Buzzer_PatternType *pattern) {
+	uint16 first = Buzzer_stepLength(pattern, 0);
+	uint8 sreg = SREG;
+
+	cli();
+	if (g_pattern != NULL_PTR && pgm_read_byte(&g_pattern->priority) > pgm_read_byte(&pattern->priority)) {
+		SREG = sreg;
+		return FALSE;  // Keep the more important pattern
+	}
+	if (first == 0) {
+		g_pattern = NULL_PTR;  // Empty pattern: silence
+		BUZZER_PORT &= ~(1 << BUZZER_PIN);
+	} else {
+		g_step = 0;
+		g_stepLeft = first;
+		g_playsLeft = pgm_read_byte(&pattern->repeat);
+		g_pattern = pattern;
+		Buzzer_setStep(0);
+	}
+	SREG = sreg;
+	return TRUE;
+}
+
+void Buzzer_cancel(const Buzzer_PatternType *pattern) {
+	uint8 sreg = SREG;
+
+	cli();
+	if (g_pattern == pattern) {
+		g_pattern = NULL_PTR;
+		BUZZER_PORT &= ~(1 << BUZZER_PIN);
+	}
+	SREG = sreg;
+}
+
+boolean Buzzer_isPlaying(void) {
+	return (g_pattern != NULL_PTR) ? TRUE : FALSE;
 }
\ No newline at end of file
@@ -10,17 +10,38 @@
 #define BUZZER_H_
 
 #include <avr/io.h>
+#include "std_types.h"
 
 // Macro Definitions for Buzzer
 #define BUZZER_PORT PORTC
 #define BUZZER_PIN PC7
 #define BUZZER_DDR DDRC
 
+// Pattern sequencer, run from the 1 ms system tick
+#define BUZZER_STEP_MS 10              // Unit of the pattern step lengths
+#define BUZZER_MAX_STEPS 8             // Steps in a pattern: on, off, on, off...
+#define BUZZER_REPEAT_FOREVER 0        // Pattern repeat count: until cancelled
+
+// On/off pattern, stored in PROGMEM
+typedef struct {
+	uint8 priority;                    // A pattern only replaces one of the same or a lower priority
+	uint8 repeat;                      // Times the steps are played, or BUZZER_REPEAT_FOREVER
+	uint8 steps[BUZZER_MAX_STEPS];     // Step lengths in BUZZER_STEP_MS, on first; a 0 ends the pattern early
+} Buzzer_PatternType;
+
 
 // Function Prototypes
 void Buzzer_init(void);
-void Buzzer_on(void);
-void Buzzer_off(void);
+void Buzzer_on(void);  // Solid tone, cancels any pattern
+void Buzzer_off(void);  // Silence, cancels any pattern
+
+// Start a pattern and return at once; FALSE if a higher priority pattern is playing
+boolean Buzzer_play(const Buzzer_PatternType *pattern);
+
+// Stop a pattern if it is still the one playing, so a later pattern is not cut short
+void Buzzer_cancel(const Buzzer_PatternType *pattern);
+
+boolean Buzzer_isPlaying(void);
 
 
 
@@ -0,0 +1,81 @@
+ /******************************************************************************
+ *
+ * Module: CMAC
+ *
+ * File Name: cmac.h
+ *
+ * Description: Header file for CMAC (RFC 4493 construction) over Speck64/128.
+ *              With a 64-bit block the subkey constant is 0x1B. Messages can
+ *              be fed in pieces, so a tag can be built up while data arrives.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef CMAC_H_
+#define CMAC_H_
+
+#include "std_types.h"
+#include "speck.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define CMAC_TAG_SIZE   SPECK_BLOCK_SIZE
+
+typedef struct
+{
+    Speck_KeyType cipher;
+    uint8 k1[SPECK_BLOCK_SIZE];  // Subkey for a complete last block
+    uint8 k2[SPECK_BLOCK_SIZE];  // Subkey for a padded last block
+} Cmac_KeyType;
+
+typedef struct
+{
+    uint8 chain[SPECK_BLOCK_SIZE];   // Cipher output of the blocks processed so far
+    uint8 buffer[SPECK_BLOCK_SIZE];  // Last block, held back until it is known to be the last
+    uint8 used;
+} Cmac_StateType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Expand a SPECK_KEY_SIZE byte key and derive the two subkeys.
+ */
+void Cmac_setKey(Cmac_KeyType *key, const uint8 *secret);
+
+/*
+ * Description :
+ * Start a new message.
+ */
+void Cmac_start(Cmac_StateType *state);
+
+/*
+ * Description :
+ * Add length bytes to the message.
+ */
+void Cmac_update(const Cmac_KeyType *key, Cmac_StateType *state, const uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Finish the message and write its CMAC_TAG_SIZE byte tag.
+ */
+void Cmac_finish(const Cmac_KeyType *key, Cmac_StateType *state, uint8 *tag);
+
+/*
+ * Description :
+ * Tag of a message held in one buffer.
+ */
+void Cmac_compute(const Cmac_KeyType *key, const uint8 *data, uint8 length, uint8 *tag);
+
+/*
+ * Description :
+ * Compare two tags in a time that does not depend on where they differ.
+ */
+boolean Cmac_equal(const uint8 *a, const uint8 *b, uint8 length);
+
+#endif /* CMAC_H_ */
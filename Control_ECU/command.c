@@ -0,0 +1,82 @@
+ /******************************************************************************
+ *
+ * Module: Command
+ *
+ * File Name: command.c
+ *
+ * Description: Source file for the command dispatcher of Control_ECU
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "command.h"
+#include "link.h"
+#include <avr/pgmspace.h>
+
+static const Command_EntryType *g_commandTable = NULL_PTR;
+static uint16 g_unknownOpcodes = 0;
+
+void Command_init(const Command_EntryType *table)
+{
+	g_commandTable = table;
+}
+
+void Command_dispatch(const uint8 *message, uint8 length)
+{
+	Command_EntryType entry;
+	uint8 opcode = message[0];
+	uint8 reply = COMMAND_NO_REPLY;
+	uint8 first = 1;
+
+	/* O(1) lookup, whatever the number of commands */
+	if (g_commandTable == NULL_PTR || length == 0 || opcode >= COMMAND_TABLE_SIZE)
+	{
+		g_unknownOpcodes++;
+		return;
+	}
+	memcpy_P(&entry, &g_commandTable[opcode], sizeof(Command_EntryType));
+	if ((entry.handler == NULL_PTR && entry.complete == NULL_PTR) || entry.argLength > COMMAND_MAX_ARGS)
+	{
+		g_unknownOpcodes++;
+		return;
+	}
+
+	if (entry.flags & COMMAND_FLAG_FRAMED)
+	{
+		/* Skip anything until the start of the arguments */
+		while (first < length && message[first] != COMMAND_FRAME_START)
+		{
+			first++;
+		}
+		first++;
+	}
+	if (first + entry.argLength > length)
+	{
+		g_unknownOpcodes++;  /* Arguments cut short */
+		return;
+	}
+
+	if (entry.handler != NULL_PTR)
+	{
+		reply = entry.handler(&message[first]);
+	}
+	if (reply != COMMAND_NO_REPLY)
+	{
+		/*
+		 * A missing ACK does not tell whether the reply got through or only
+		 * its ACK was lost, so the completion runs either way and HMI_ECU
+		 * confirms the outcome in the exchanges that follow.
+		 */
+		Link_send(&reply, 1);
+	}
+	if (entry.complete != NULL_PTR)
+	{
+		entry.complete(reply);
+	}
+}
+
+uint16 Command_getUnknownCount(void)
+{
+	return g_unknownOpcodes;
+}
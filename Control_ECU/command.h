@@ -0,0 +1,70 @@
+ /******************************************************************************
+ *
+ * Module: Command
+ *
+ * File Name: command.h
+ *
+ * Description: Header file for the command dispatcher of Control_ECU.
+ *              Commands are link messages whose first byte is the opcode,
+ *              looked up in a table in flash; each entry gives the argument
+ *              length, the handler computing the reply byte and the work to
+ *              run once the reply is acknowledged.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define COMMAND_TABLE_SIZE   0x40  /* Opcodes 0x00 to 0x3F */
+#define COMMAND_MAX_ARGS     8
+#define COMMAND_NO_REPLY     0xFF  /* Handler result: send nothing */
+
+/* Entry flags */
+#define COMMAND_FLAG_FRAMED  0x01  /* Arguments follow a START_COMMUNICATION byte in the message */
+
+/* Sync byte of framed arguments, same as START_COMMUNICATION of the applications */
+#define COMMAND_FRAME_START  0x15
+
+/* One command, stored in PROGMEM. An entry without handler and completion is unknown. */
+typedef struct
+{
+    uint8 (*handler)(const uint8 *args);   // Returns the reply byte or COMMAND_NO_REPLY; may be NULL_PTR
+    void (*complete)(uint8 reply);         // Runs after the reply is sent, even unacknowledged, so it must cope with HMI_ECU missing it; may be NULL_PTR
+    uint8 argLength;                       // Argument bytes after the opcode (or the frame start)
+    uint8 flags;
+} Command_EntryType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the opcode-indexed table (PROGMEM, COMMAND_TABLE_SIZE entries).
+ */
+void Command_init(const Command_EntryType *table);
+
+/*
+ * Description :
+ * Run the command of a received message: call the handler with the
+ * arguments, send the reply and run the completion. Unknown opcodes and
+ * short messages are dropped and counted. The completion runs whether the
+ * reply is acknowledged or not: the ACK may be the part that was lost.
+ */
+void Command_dispatch(const uint8 *message, uint8 length);
+
+/*
+ * Description :
+ * Number of unknown or malformed commands received since reset.
+ */
+uint16 Command_getUnknownCount(void);
+
+#endif /* COMMAND_H_ */
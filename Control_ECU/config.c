@@ -0,0 +1,126 @@
+ /******************************************************************************
+ *
+ * Module: Config
+ *
+ * File Name: config.c
+ *
+ * Description: Source file for the installer settings of Control_ECU, in the
+ *              external EEPROM through the write-back buffer
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "config.h"
+#include "eeprom_buffer.h"
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include <string.h>
+
+#define CONFIG_ADDRESS  0x0350  /* Page aligned, after the lockout state */
+
+/* Stored record: the settings between a version and a CRC */
+typedef struct
+{
+    uint8 version;          // CONFIG_VERSION
+    Config_Type config;
+    uint16 crc;             // CRC-CCITT of the version and the settings
+} Config_RecordType;
+
+/* Range and default of each field, same table on both ECUs */
+typedef struct
+{
+    uint16 min;
+    uint16 max;
+    uint16 def;
+} Config_LimitType;
+
+static const Config_LimitType g_limits[CONFIG_FIELDS] PROGMEM = {
+	[CONFIG_DOOR_TRAVEL_TIME] = {5, 60, 13},
+	[CONFIG_DOOR_RAMP_TIME] = {0, 2500, 1000},
+	[CONFIG_STALL_RETRIES] = {0, 10, 3},
+	[CONFIG_ATTEMPTS_LIMIT] = {1, 10, 3},
+	[CONFIG_LOCKOUT_TIME] = {10, 1800, 60},
+	[CONFIG_SPLASH_DELAY] = {0, 5000, 1000},
+	[CONFIG_MESSAGE_DELAY] = {250, 5000, 1000},
+};
+
+static Config_RecordType g_record;
+
+static uint16 Config_crc(const Config_RecordType *record)
+{
+	const uint8 *bytes = (const uint8 *)record;
+	uint16 crc = 0xFFFF;
+	uint8 i;
+
+	for (i = 0; i < sizeof(Config_RecordType) - sizeof(uint16); i++)
+	{
+		crc = _crc_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
+
+static boolean Config_isValid(uint8 field, uint16 value)
+{
+	return (value >= pgm_read_word(&g_limits[field].min) && value <= pgm_read_word(&g_limits[field].max)) ? TRUE : FALSE;
+}
+
+static void Config_save(void)
+{
+	g_record.version = CONFIG_VERSION;
+	g_record.crc = Config_crc(&g_record);
+	EEPROM_BUF_write(CONFIG_ADDRESS, (const uint8 *)&g_record, sizeof(g_record));
+}
+
+void Config_load(void)
+{
+	uint16 *fields = (uint16 *)&g_record.config;
+	uint8 field;
+
+	EEPROM_BUF_read(CONFIG_ADDRESS, (uint8 *)&g_record, sizeof(g_record));
+	if (g_record.version == CONFIG_VERSION && g_record.crc == Config_crc(&g_record))
+	{
+		return;
+	}
+	/* Blank memory, older layout or a torn write: nothing is stored until an installer sets a field */
+	for (field = 0; field < CONFIG_FIELDS; field++)
+	{
+		fields[field] = pgm_read_word(&g_limits[field].def);
+	}
+}
+
+const Config_Type *Config_get(void)
+{
+	return &g_record.config;
+}
+
+boolean Config_set(uint8 field, uint16 value)
+{
+	if (field >= CONFIG_FIELDS || !Config_isValid(field, value))
+	{
+		return FALSE;
+	}
+	((uint16 *)&g_record.config)[field] = value;
+	Config_save();
+	return TRUE;
+}
+
+boolean Config_replace(const Config_Type *config)
+{
+	const uint16 *fields = (const uint16 *)config;
+	uint8 field;
+
+	for (field = 0; field < CONFIG_FIELDS; field++)
+	{
+		if (!Config_isValid(field, fields[field]))
+		{
+			return FALSE;
+		}
+	}
+	if (memcmp(&g_record.config, config, sizeof(Config_Type)) != 0)
+	{
+		g_record.config = *config;
+		Config_save();
+	}
+	return TRUE;
+}
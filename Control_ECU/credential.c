@@ -0,0 +1,77 @@
+ /******************************************************************************
+ *
+ * Module: Credential
+ *
+ * File Name: credential.c
+ *
+ * Description: Source file for the password check of Control_ECU
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "credential.h"
+
+/* Derivation labels under the link key, after the two used by the link cipher */
+#define CREDENTIAL_LABEL    3
+
+static Cmac_KeyType g_key;
+static Cmac_StateType g_state;
+static uint8 g_count = 0;           // Digits absorbed in the current entry
+static boolean g_valid = FALSE;     // Entry started and every digit came in order
+
+void Credential_setKey(const uint8 *linkKey)
+{
+	uint8 derived[CMAC_TAG_SIZE * 2];
+	uint8 label;
+
+	Cmac_setKey(&g_key, linkKey);
+	for (label = 0; label < 2; label++)
+	{
+		uint8 input = CREDENTIAL_LABEL + label;
+
+		Cmac_compute(&g_key, &input, 1, &derived[label * CMAC_TAG_SIZE]);
+	}
+	Cmac_setKey(&g_key, derived);
+	g_valid = FALSE;
+}
+
+void Credential_start(void)
+{
+	Cmac_start(&g_state);
+	g_count = 0;
+	g_valid = TRUE;
+}
+
+void Credential_absorb(uint8 position, uint8 digit)
+{
+	if (position == 0)
+	{
+		Credential_start();
+	}
+	if (!g_valid || position != g_count)
+	{
+		g_valid = FALSE;
+		return;
+	}
+	Cmac_update(&g_key, &g_state, &digit, 1);
+	g_count++;
+}
+
+boolean Credential_verify(uint8 length, const uint8 *storedTag)
+{
+	uint8 tag[CREDENTIAL_TAG_SIZE];
+	boolean match;
+
+	/* Always finish and compare, so a spoilt entry takes as long as a good one */
+	Cmac_finish(&g_key, &g_state, tag);
+	match = Cmac_equal(tag, storedTag, CREDENTIAL_TAG_SIZE);
+	match = (match && g_valid && g_count == length) ? TRUE : FALSE;
+	g_valid = FALSE;
+	return match;
+}
+
+void Credential_compute(const uint8 *digits, uint8 length, uint8 *tag)
+{
+	Cmac_compute(&g_key, digits, length, tag);
+}
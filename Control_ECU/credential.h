@@ -0,0 +1,66 @@
+ /******************************************************************************
+ *
+ * Module: Credential
+ *
+ * File Name: credential.h
+ *
+ * Description: Header file for the password check of Control_ECU. Only a
+ *              CMAC tag of the password is stored. Digits are absorbed one
+ *              by one while the user types, so at Enter only the last
+ *              block and a constant-time compare are left.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef CREDENTIAL_H_
+#define CREDENTIAL_H_
+
+#include "std_types.h"
+#include "cmac.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define CREDENTIAL_TAG_SIZE     CMAC_TAG_SIZE
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Derive the credential key from the link key. Stored tags only match
+ * under the link key they were made with.
+ */
+void Credential_setKey(const uint8 *linkKey);
+
+/*
+ * Description :
+ * Forget the digits absorbed so far and start a new entry.
+ */
+void Credential_start(void);
+
+/*
+ * Description :
+ * Absorb the digit at a position of the current entry (0 starts a new
+ * one). A digit out of order spoils the entry until the next position 0.
+ */
+void Credential_absorb(uint8 position, uint8 digit);
+
+/*
+ * Description :
+ * Finish the current entry and compare it in constant time with a stored
+ * tag. TRUE only if exactly length digits were absorbed in order. The
+ * entry is spent either way.
+ */
+boolean Credential_verify(uint8 length, const uint8 *storedTag);
+
+/*
+ * Description :
+ * Tag of a whole password, to be stored.
+ */
+void Credential_compute(const uint8 *digits, uint8 length, uint8 *tag);
+
+#endif /* CREDENTIAL_H_ */
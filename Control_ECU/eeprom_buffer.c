@@ -0,0 +1,300 @@
+ /******************************************************************************
+ *
+ * Module: EEPROM write-back buffer
+ *
+ * File Name: eeprom_buffer.c
+ *
+ * Description: Source file for the RAM staging layer on top of the external
+ *              EEPROM driver
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "eeprom_buffer.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/crc16.h>
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Upper bound of acknowledge polls while waiting for a write cycle (~10 ms) */
+#define EEPROM_BUF_READY_POLLS 200
+
+/* The dirty mask has one bit per byte of a page */
+#if (EEPROM_PAGE_SIZE > 16)
+#error "EEPROM_PAGE_SIZE does not fit the uint16 dirty mask of a staging slot"
+#endif
+
+/* One staging slot mirrors a single EEPROM page */
+typedef struct
+{
+	uint16 page;                    // Page aligned base address
+	uint16 dirty;                   // One bit per byte not committed yet, 0 = slot free
+	uint8 data[EEPROM_PAGE_SIZE];   // Staged bytes
+	uint16 crc;                     // CRC over page, dirty and data
+} EEPROM_BUF_SlotType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+static EEPROM_BUF_SlotType g_slots[EEPROM_BUF_SLOTS];
+static uint8 g_nextVictim = 0;  // Slot committed synchronously when all slots are busy
+
+/*******************************************************************************
+ *                      Functions Definitions(Private)                         *
+ *******************************************************************************/
+
+static uint16 EEPROM_BUF_slotCrc(const EEPROM_BUF_SlotType *slot)
+{
+	const uint8 *bytes = (const uint8 *)slot;
+	uint16 crc = 0xFFFF;
+	uint8 i;
+
+	/* Everything except the crc field itself */
+	for (i = 0; i < (uint8)(sizeof(EEPROM_BUF_SlotType) - sizeof(uint16)); i++)
+	{
+		crc = _crc_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
+
+static uint8 EEPROM_BUF_waitReady(void)
+{
+	uint8 polls = EEPROM_BUF_READY_POLLS;
+
+	while (EEPROM_isReady() != SUCCESS)
+	{
+		if (--polls == 0)
+		{
+			return ERROR;
+		}
+	}
+	return SUCCESS;
+}
+
+/* Write the first contiguous run of dirty bytes of a slot in one page write */
+static uint8 EEPROM_BUF_commitRun(EEPROM_BUF_SlotType *slot)
+{
+	uint8 first = 0;
+	uint8 last;
+	uint8 sreg;
+
+	if (EEPROM_BUF_slotCrc(slot) != slot->crc)
+	{
+		/* RAM copy is corrupted, never write garbage to the memory */
+		slot->dirty = 0;
+		return ERROR;
+	}
+
+	while (!(slot->dirty & (1u << first)))
+	{
+		first++;
+	}
+	last = first;
+	while ((last + 1 < EEPROM_PAGE_SIZE) && (slot->dirty & (1u << (last + 1))))
+	{
+		last++;
+	}
+
+	if (EEPROM_writePage(slot->page + first, &slot->data[first], last - first + 1) != SUCCESS)
+	{
+		return ERROR;
+	}
+
+	/* Retire the run only once the transaction went through, never leaving a stale CRC for the power-fail flush */
+	sreg = SREG;
+	cli();
+	for (; first <= last; first++)
+	{
+		slot->dirty &= ~(1u << first);
+	}
+	slot->crc = EEPROM_BUF_slotCrc(slot);
+	SREG = sreg;
+	return SUCCESS;
+}
+
+static EEPROM_BUF_SlotType *EEPROM_BUF_findSlot(uint16 page)
+{
+	uint8 i;
+
+	for (i = 0; i < EEPROM_BUF_SLOTS; i++)
+	{
+		if (g_slots[i].dirty && g_slots[i].page == page)
+		{
+			return &g_slots[i];
+		}
+	}
+	return NULL_PTR;
+}
+
+static EEPROM_BUF_SlotType *EEPROM_BUF_allocSlot(uint16 page)
+{
+	EEPROM_BUF_SlotType *slot;
+	uint8 i;
+
+	for (i = 0; i < EEPROM_BUF_SLOTS; i++)
+	{
+		if (!g_slots[i].dirty)
+		{
+			g_slots[i].page = page;
+			return &g_slots[i];
+		}
+	}
+
+	/* Every slot is in use: apply back-pressure by committing the oldest one */
+	slot = &g_slots[g_nextVictim];
+	g_nextVictim = (g_nextVictim + 1) % EEPROM_BUF_SLOTS;
+	while (slot->dirty)
+	{
+		if (EEPROM_BUF_waitReady() != SUCCESS || EEPROM_BUF_commitRun(slot) != SUCCESS)
+		{
+			return NULL_PTR;
+		}
+	}
+	slot->page = page;
+	return slot;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+void EEPROM_BUF_init(void)
+{
+	uint8 i;
+
+	for (i = 0; i < EEPROM_BUF_SLOTS; i++)
+	{
+		g_slots[i].dirty = 0;
+	}
+	g_nextVictim = 0;
+}
+
+uint8 EEPROM_BUF_write(uint16 u16addr, const uint8 *data, uint8 len)
+{
+	while (len > 0)
+	{
+		uint16 page = u16addr & ~(uint16)(EEPROM_PAGE_SIZE - 1);
+		uint8 offset = u16addr & (EEPROM_PAGE_SIZE - 1);
+		uint8 run = EEPROM_PAGE_SIZE - offset;
+		EEPROM_BUF_SlotType *slot;
+		uint8 sreg;
+		uint8 i;
+
+		if (run > len)
+		{
+			run = len;
+		}
+
+		/* Allocation may commit the oldest slot synchronously: keep interrupts enabled for it */
+		slot = EEPROM_BUF_findSlot(page);
+		if (slot == NULL_PTR)
+		{
+			slot = EEPROM_BUF_allocSlot(page);
+			if (slot == NULL_PTR)
+			{
+				return ERROR;
+			}
+		}
+
+		/*
+		 * The power-fail handler flushes from the ADC interrupt and drops a
+		 * slot whose CRC does not match: stage the bytes of this page and
+		 * their CRC as one step, so an interrupted write is never lost.
+		 */
+		sreg = SREG;
+		cli();
+		for (i = 0; i < run; i++)
+		{
+			slot->data[offset + i] = data[i];
+			slot->dirty |= (1u << (offset + i));
+		}
+		slot->crc = EEPROM_BUF_slotCrc(slot);
+		SREG = sreg;
+
+		u16addr += run;
+		data += run;
+		len -= run;
+	}
+	return SUCCESS;
+}
+
+uint8 EEPROM_BUF_read(uint16 u16addr, uint8 *data, uint8 len)
+{
+	uint8 i;
+
+	for (i = 0; i < len; i++, u16addr++)
+	{
+		EEPROM_BUF_SlotType *slot = EEPROM_BUF_findSlot(u16addr & ~(uint16)(EEPROM_PAGE_SIZE - 1));
+		uint8 offset = u16addr & (EEPROM_PAGE_SIZE - 1);
+
+		if (slot != NULL_PTR && (slot->dirty & (1u << offset)))
+		{
+			data[i] = slot->data[offset];
+		}
+		else if (EEPROM_BUF_waitReady() != SUCCESS || EEPROM_readByte(u16addr, &data[i]) != SUCCESS)
+		{
+			return ERROR;
+		}
+	}
+	return SUCCESS;
+}
+
+void EEPROM_BUF_service(void)
+{
+	uint8 i;
+
+	for (i = 0; i < EEPROM_BUF_SLOTS; i++)
+	{
+		if (g_slots[i].dirty)
+		{
+			/* Do not wait for a running write cycle, try again next idle pass */
+			if (EEPROM_isReady() == SUCCESS)
+			{
+				EEPROM_BUF_commitRun(&g_slots[i]);
+			}
+			return;
+		}
+	}
+}
+
+uint8 EEPROM_BUF_flush(void)
+{
+	uint8 i;
+
+	for (i = 0; i < EEPROM_BUF_SLOTS; i++)
+	{
+		while (g_slots[i].dirty)
+		{
+			if (EEPROM_BUF_waitReady() != SUCCESS || EEPROM_BUF_commitRun(&g_slots[i]) != SUCCESS)
+			{
+				return ERROR;
+			}
+		}
+	}
+
+	/* Data is durable only once the last internal write cycle is over */
+	return EEPROM_BUF_waitReady();
+}
+
+uint8 EEPROM_BUF_pendingBytes(void)
+{
+	uint8 count = 0;
+	uint8 i, bit;
+
+	for (i = 0; i < EEPROM_BUF_SLOTS; i++)
+	{
+		for (bit = 0; bit < EEPROM_PAGE_SIZE; bit++)
+		{
+			if (g_slots[i].dirty & (1u << bit))
+			{
+				count++;
+			}
+		}
+	}
+	return count;
+}
@@ -0,0 +1,75 @@
+ /******************************************************************************
+ *
+ * Module: EEPROM write-back buffer
+ *
+ * File Name: eeprom_buffer.h
+ *
+ * Description: Header file for the RAM staging layer on top of the external
+ *              EEPROM driver. Writes are acknowledged as soon as they are
+ *              staged (CRC protected) in RAM and are committed page by page
+ *              from the main loop while the door is idle.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef EEPROM_BUFFER_H_
+#define EEPROM_BUFFER_H_
+
+#include "std_types.h"
+#include "external_eeprom.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Number of page sized staging slots kept in RAM */
+#define EEPROM_BUF_SLOTS 2
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Clear all staging slots. Must be called once before any other function.
+ */
+void EEPROM_BUF_init(void);
+
+/*
+ * Description :
+ * Stage len bytes for writing at u16addr. Returns as soon as the data is in
+ * RAM; only blocks (committing the oldest slot) when every slot is in use.
+ * The bytes of each page are staged with interrupts masked, so a flush from
+ * the power-fail interrupt sees all of them or none.
+ */
+uint8 EEPROM_BUF_write(uint16 u16addr, const uint8 *data, uint8 len);
+
+/*
+ * Description :
+ * Read len bytes at u16addr. Staged bytes that are not committed yet are
+ * returned from RAM so readers always see the latest written value.
+ */
+uint8 EEPROM_BUF_read(uint16 u16addr, uint8 *data, uint8 len);
+
+/*
+ * Description :
+ * Commit at most one contiguous run of staged bytes if the memory is not busy
+ * with a previous write cycle. Never blocks; call it from the idle loop.
+ */
+void EEPROM_BUF_service(void);
+
+/*
+ * Description :
+ * Durability barrier: commit everything that is staged and wait for the last
+ * write cycle to finish. Safe to call from the power-fail path.
+ */
+uint8 EEPROM_BUF_flush(void);
+
+/*
+ * Description :
+ * Return the number of staged bytes that are not committed yet.
+ */
+uint8 EEPROM_BUF_pendingBytes(void);
+
+#endif /* EEPROM_BUFFER_H_ */
@@ -80,3 +80,61 @@ uint8 EEPROM_readByte(uint16 u16addr, uint8 *u8data)
 
     return SUCCESS;
 }
+
+/*
+ * Write up to EEPROM_PAGE_SIZE bytes in a single transaction. The caller must
+ * make sure [u16addr, u16addr + len) does not cross a page boundary, otherwise
+ * the memory wraps around to the start of the same page.
+ */
+uint8 EEPROM_writePage(uint16 u16addr, const uint8 *data, uint8 len)
+{
+    uint8 i;
+
+	/* Send the Start Bit */
+    TWI_start();
+    if (TWI_getStatus() != TWI_START)
+        return ERROR;
+
+    /* Send the device address with A8 A9 A10 and R/W=0 (write) */
+    TWI_writeByte((uint8)(0xA0 | ((u16addr & 0x0700)>>7)));
+    if (TWI_getStatus() != TWI_MT_SLA_W_ACK)
+        return ERROR;
+
+    /* Send the required memory location address */
+    TWI_writeByte((uint8)(u16addr));
+    if (TWI_getStatus() != TWI_MT_DATA_ACK)
+        return ERROR;
+
+    /* Stream the page bytes, the memory auto-increments the word address */
+    for (i = 0; i < len; i++)
+    {
+        TWI_writeByte(data[i]);
+        if (TWI_getStatus() != TWI_MT_DATA_ACK)
+            return ERROR;
+    }
+
+    /* Send the Stop Bit, this starts the internal write cycle */
+    TWI_stop();
+
+    return SUCCESS;
+}
+
+/*
+ * Acknowledge polling: the memory does not answer its address while an
+ * internal write cycle is in progress, so a NACK means "still busy".
+ */
+uint8 EEPROM_isReady(void)
+{
+    uint8 status;
+
+    TWI_start();
+    if (TWI_getStatus() != TWI_START)
+        return ERROR;
+
+    TWI_writeByte(0xA0);
+    status = TWI_getStatus();
+
+    TWI_stop();
+
+    return (status == TWI_MT_SLA_W_ACK) ? SUCCESS : ERROR;
+}
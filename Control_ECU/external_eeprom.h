@@ -22,11 +22,16 @@
 #define ERROR 0
 #define SUCCESS 1
 
+/* 24C16 page size: one write transaction may not cross a page boundary */
+#define EEPROM_PAGE_SIZE 16
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 uint8 EEPROM_writeByte(uint16 u16addr,uint8 u8data);
 uint8 EEPROM_readByte(uint16 u16addr,uint8 *u8data);
+uint8 EEPROM_writePage(uint16 u16addr,const uint8 *data,uint8 len);
+uint8 EEPROM_isReady(void);
  
 #endif /* EXTERNAL_EEPROM_H_ */
@@ -0,0 +1,99 @@
+ /******************************************************************************
+ *
+ * Module: Idle
+ *
+ * File Name: idle.c
+ *
+ * Description: Source file for the idle hook
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "idle.h"
+#include "systick.h"
+#include <avr/sleep.h>
+#include <avr/interrupt.h>
+
+static uint32 g_windowStart = 0;      // Systick time the statistics window started
+static uint32 g_idleMs = 0;
+static uint16 g_idleUs = 0;           // Sleep time below one ms, folded into g_idleMs
+static uint16 g_maxWakeLatencyUs = 0;
+static uint32 g_sleeps = 0;
+
+void Idle_sleep(void)
+{
+	Idle_sleepUnless(NULL_PTR);
+}
+
+void Idle_sleepUnless(boolean (*isPending)(void))
+{
+	uint32 tick = Systick_getMillis();
+	uint32 before = Systick_getMicros();
+	uint32 slept;
+	uint8 sreg = SREG;
+
+	/*
+	 * Idle keeps the timers, the USART, TWI and the ADC clocked, so every
+	 * driver interrupt wakes the CPU. Power-save would stop Timer1 and the
+	 * USART receiver, both needed to wake up.
+	 */
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	cli();
+	if (isPending == NULL_PTR || !isPending())
+	{
+		/* The instruction after SEI always runs first, so an interrupt held back since the check wakes SLEEP at once */
+		sleep_enable();
+		sei();
+		sleep_cpu();
+		sleep_disable();
+	}
+	SREG = sreg;
+
+	slept = Systick_getMicros() - before;
+	if (Systick_getMillis() != tick)
+	{
+		/* Woken by (or through) a tick: the time since the tick is the wake latency */
+		uint16 latency = Systick_getTickPhaseUs();
+		if (latency > g_maxWakeLatencyUs)
+		{
+			g_maxWakeLatencyUs = latency;
+		}
+	}
+
+	g_sleeps++;
+	g_idleMs += slept / 1000;
+	g_idleUs += (uint16)(slept % 1000);
+	if (g_idleUs >= 1000)
+	{
+		g_idleUs -= 1000;
+		g_idleMs++;
+	}
+}
+
+void Idle_delayMs(uint16 ms)
+{
+	uint32 start = Systick_getMillis();
+
+	/* Whole ticks are counted, so wait one more to never return early */
+	while (Systick_elapsedSince(start) <= ms)
+	{
+		Idle_sleep();
+	}
+}
+
+void Idle_getStats(Idle_StatsType *stats)
+{
+	uint32 window = Systick_elapsedSince(g_windowStart);
+	uint32 percent = (window >= 100) ? g_idleMs / (window / 100) : 0;
+
+	stats->idlePercent = (percent > 100) ? 100 : (uint8)percent;
+	stats->maxWakeLatencyUs = g_maxWakeLatencyUs;
+	stats->sleeps = g_sleeps;
+
+	g_windowStart += window;
+	g_idleMs = 0;
+	g_idleUs = 0;
+	g_maxWakeLatencyUs = 0;
+	g_sleeps = 0;
+}
@@ -0,0 +1,77 @@
+ /******************************************************************************
+ *
+ * Module: Keystore
+ *
+ * File Name: keystore.c
+ *
+ * Description: Source file for the link key storage of Control_ECU, in the
+ *              external EEPROM through the write-back buffer
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "keystore.h"
+#include "eeprom_buffer.h"
+
+/* Record layout, the key on a page of its own */
+#define KEYSTORE_KEY_ADDRESS        0x0320
+#define KEYSTORE_STATE_ADDRESS      0x0330  /* KEYSTORE_STATE_* */
+#define KEYSTORE_SESSION_ADDRESS    0x0331  /* Two uint16, tx then rx */
+
+#define KEYSTORE_STATE_BLANK        0xFF
+#define KEYSTORE_STATE_PENDING      0x5A    /* Key stored, peer not heard from yet */
+#define KEYSTORE_STATE_PAIRED       0xA5
+
+static uint8 Keystore_readState(void)
+{
+	uint8 state = KEYSTORE_STATE_BLANK;
+
+	EEPROM_BUF_read(KEYSTORE_STATE_ADDRESS, &state, 1);
+	return state;
+}
+
+boolean Keystore_readKey(uint8 *key)
+{
+	uint8 state = Keystore_readState();
+
+	if (state != KEYSTORE_STATE_PENDING && state != KEYSTORE_STATE_PAIRED)
+	{
+		return FALSE;
+	}
+	return (EEPROM_BUF_read(KEYSTORE_KEY_ADDRESS, key, KEYSTORE_KEY_LENGTH) == SUCCESS) ? TRUE : FALSE;
+}
+
+void Keystore_writeKey(const uint8 *key)
+{
+	uint8 state = KEYSTORE_STATE_PENDING;
+
+	EEPROM_BUF_write(KEYSTORE_KEY_ADDRESS, key, KEYSTORE_KEY_LENGTH);
+	EEPROM_BUF_write(KEYSTORE_STATE_ADDRESS, &state, 1);
+	EEPROM_BUF_flush();  /* The key must survive a reset before it is handed out */
+}
+
+boolean Keystore_isPaired(void)
+{
+	return (Keystore_readState() == KEYSTORE_STATE_PAIRED) ? TRUE : FALSE;
+}
+
+void Keystore_setPaired(void)
+{
+	uint8 state = KEYSTORE_STATE_PAIRED;
+
+	EEPROM_BUF_write(KEYSTORE_STATE_ADDRESS, &state, 1);
+}
+
+uint16 Keystore_readSession(uint8 direction)
+{
+	uint16 session = 0xFFFF;
+
+	EEPROM_BUF_read(KEYSTORE_SESSION_ADDRESS + 2 * direction, (uint8 *)&session, sizeof(session));
+	return (session == 0xFFFF) ? 0 : session;
+}
+
+void Keystore_writeSession(uint8 direction, uint16 session)
+{
+	EEPROM_BUF_write(KEYSTORE_SESSION_ADDRESS + 2 * direction, (const uint8 *)&session, sizeof(session));
+}
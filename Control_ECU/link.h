@@ -0,0 +1,129 @@
+ /******************************************************************************
+ *
+ * Module: Link
+ *
+ * File Name: link.h
+ *
+ * Description: Header file for the reliable inter-ECU link. Messages travel
+ *              in frames (SOF, control, length, payload, CRC-16) and each
+ *              one is acknowledged before the next is sent (stop-and-wait).
+ *              Lost frames are retransmitted, duplicates are dropped, and a
+ *              peer that stops answering turns into a timeout instead of a
+ *              hang: the link goes down until the rate is negotiated again.
+ *              Once a key is set, every frame also carries a counter and a
+ *              CMAC tag over the sender's role too: forged or reflected
+ *              frames fail the tag and replayed ones the counter, which only
+ *              grows (session number from EEPROM in the upper half, so a
+ *              reset never makes old frames fresh again).
+ *              Secret frames are also encrypted (Speck counter mode, the
+ *              frame counter and direction as nonce) before being tagged.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef LINK_H_
+#define LINK_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define LINK_SOF            0x7E
+#define LINK_MAX_PAYLOAD    16
+
+/* Control byte: authentication flag, frame type, secret flag, sequence number */
+#define LINK_FLAG_AUTH      0x80  /* Counter and tag follow the payload */
+#define LINK_TYPE_DATA      0x00
+#define LINK_TYPE_ACK       0x40
+#define LINK_TYPE_MASK      0x40
+#define LINK_FLAG_SECRET    0x20  /* Payload encrypted, authenticated frames only */
+#define LINK_SEQ_MASK       0x1F
+
+/* Authenticated frames: little-endian counter, then the CMAC tag truncated */
+#define LINK_COUNTER_LENGTH 4
+#define LINK_TAG_LENGTH     4
+#define LINK_AUTH_LENGTH    (LINK_COUNTER_LENGTH + LINK_TAG_LENGTH)
+
+#define LINK_BYTE_TIMEOUT   10    /* ms between two bytes of the same frame */
+#define LINK_ACK_TIMEOUT    200   /* ms to wait for the ACK of a frame */
+#define LINK_MAX_RETRIES    5     /* Retransmissions before the link is declared down */
+
+/* Link_setKey roles, so the two directions never share a nonce or a tag */
+#define LINK_ROLE_MASTER    0     /* Negotiates the rate (HMI_ECU) */
+#define LINK_ROLE_SLAVE     1     /* Serves the negotiation (Control_ECU) */
+
+/* Link_receive result: the peer restarted the rate negotiation */
+#define LINK_BREAK          0xFF
+
+typedef struct
+{
+    uint16 sent;         // Messages acknowledged by the peer
+    uint16 retransmits;  // Frames sent again after an ACK timeout
+    uint16 failures;     // Messages given up after LINK_MAX_RETRIES
+    uint16 duplicates;   // Received again because our ACK was lost, dropped
+    uint16 badFrames;    // Truncated or failed the CRC, dropped
+    uint16 authFailures; // Bad tag, replayed counter or unauthenticated once keyed, dropped
+} Link_StatsType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Restart the sequence numbers on both directions, start a new transmit
+ * session and bring the link up. Both ECUs call it right after a rate
+ * negotiation.
+ */
+void Link_reset(void);
+
+/*
+ * Description :
+ * Authenticate every frame from now on with a KEYSTORE_KEY_LENGTH byte key,
+ * and derive the encryption key of secret frames from it. Until paired,
+ * frames are still sent plain and plain frames still accepted; the first
+ * authenticated frame from the peer ends that and is recorded in the
+ * keystore. The two ECUs must use different roles.
+ */
+void Link_setKey(const uint8 *key, boolean paired, uint8 role);
+
+/*
+ * Description :
+ * Send a message (1 to LINK_MAX_PAYLOAD bytes) and wait for its ACK,
+ * retransmitting up to LINK_MAX_RETRIES times. Returns FALSE, and takes the
+ * link down, if the peer never acknowledged it; returns FALSE at once while
+ * the link is down.
+ */
+boolean Link_send(const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Same as Link_send, with the payload encrypted. Returns FALSE at once, and
+ * sends nothing, until the link is keyed and paired.
+ */
+boolean Link_sendSecret(const uint8 *payload, uint8 length);
+
+/*
+ * Description :
+ * Wait up to timeout_ms for the next new message from the peer and copy up
+ * to max_length bytes of it. Returns its length, 0 on timeout, or LINK_BREAK
+ * if the peer started a rate negotiation (AUTOBAUD_HELLO between frames).
+ */
+uint8 Link_receive(uint8 *payload, uint8 max_length, uint16 timeout_ms);
+
+/*
+ * Description :
+ * FALSE once a message was given up, until the next Link_reset.
+ */
+boolean Link_isUp(void);
+
+/*
+ * Description :
+ * Copy the link counters since reset.
+ */
+void Link_getStats(Link_StatsType *stats);
+
+#endif /* LINK_H_ */
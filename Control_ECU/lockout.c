@@ -0,0 +1,149 @@
+ /******************************************************************************
+ *
+ * Module: Lockout
+ *
+ * File Name: lockout.c
+ *
+ * Description: Source file for the failed password lockout of Control_ECU
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "lockout.h"
+#include "eeprom_buffer.h"
+#include "systick.h"
+#include <util/crc16.h>
+#include <string.h>
+
+#define LOCKOUT_ADDRESS         0x0340  /* Page aligned, after the keystore */
+#define LOCKOUT_VERSION         2       /* Bumped when the layout changes, 1 had a magic byte and no CRC */
+#define LOCKOUT_SAVE_INTERVAL   10      /* Seconds of countdown between two saves */
+
+typedef struct
+{
+	uint8 version;      // LOCKOUT_VERSION once written
+	uint8 attempts;     // Failures since the last success or lockout
+	uint8 level;        // Lockouts in a row, picks the next length
+	uint16 remaining;   // Seconds of lockout left
+	uint16 crc;         // CRC-CCITT of the fields above
+} Lockout_StateType;
+
+static Lockout_PolicyType g_policy;
+static Lockout_StateType g_state;
+static uint32 g_lastTick = 0;
+
+static uint16 Lockout_crc(const Lockout_StateType *state)
+{
+	const uint8 *bytes = (const uint8 *)state;
+	uint16 crc = 0xFFFF;
+	uint8 i;
+
+	for (i = 0; i < sizeof(Lockout_StateType) - sizeof(uint16); i++)
+	{
+		crc = _crc_ccitt_update(crc, bytes[i]);
+	}
+	return crc;
+}
+
+static void Lockout_save(void)
+{
+	/* Staged and committed by the idle loop; the countdown is saved every
+	 * LOCKOUT_SAVE_INTERVAL, so a reset can only make a lockout longer */
+	g_state.version = LOCKOUT_VERSION;
+	g_state.crc = Lockout_crc(&g_state);
+	EEPROM_BUF_write(LOCKOUT_ADDRESS, (const uint8 *)&g_state, sizeof(g_state));
+}
+
+void Lockout_init(const Lockout_PolicyType *policy)
+{
+	const uint8 *bytes = (const uint8 *)&g_state;
+	boolean blank = TRUE;
+	uint8 i;
+
+	Lockout_setPolicy(policy);
+	EEPROM_BUF_read(LOCKOUT_ADDRESS, (uint8 *)&g_state, sizeof(g_state));
+	if (g_state.version != LOCKOUT_VERSION || g_state.crc != Lockout_crc(&g_state))
+	{
+		for (i = 0; i < sizeof(g_state); i++)
+		{
+			blank = (bytes[i] == 0xFF) ? blank : FALSE;
+		}
+		g_state.attempts = 0;
+		g_state.level = 0;
+		/*
+		 * Blank memory: no failures yet. Anything else is a torn write, a
+		 * corrupted or an older record; it could hide a running lockout, so
+		 * a first length lockout is served rather than trusting it.
+		 */
+		g_state.remaining = blank ? 0 : g_policy.seconds[0];
+		Lockout_save();
+	}
+	g_lastTick = Systick_getMillis();
+}
+
+void Lockout_setPolicy(const Lockout_PolicyType *policy)
+{
+	memcpy(&g_policy, policy, sizeof(g_policy));
+}
+
+boolean Lockout_isActive(void)
+{
+	return (g_state.remaining != 0) ? TRUE : FALSE;
+}
+
+uint16 Lockout_getRemaining(void)
+{
+	return g_state.remaining;
+}
+
+uint8 Lockout_getAttemptsLeft(void)
+{
+	return (g_state.attempts < g_policy.attemptsLimit) ? (uint8)(g_policy.attemptsLimit - g_state.attempts) : 0;
+}
+
+boolean Lockout_recordFailure(void)
+{
+	if (g_state.remaining != 0)
+	{
+		return TRUE;
+	}
+	g_state.attempts++;
+	if (g_state.attempts >= g_policy.attemptsLimit)
+	{
+		g_state.attempts = 0;
+		g_state.remaining = g_policy.seconds[(g_state.level < LOCKOUT_LEVELS) ? g_state.level : LOCKOUT_LEVELS - 1];
+		if (g_state.level < 0xFF)
+		{
+			g_state.level++;
+		}
+		g_lastTick = Systick_getMillis();
+	}
+	Lockout_save();
+	return (g_state.remaining != 0) ? TRUE : FALSE;
+}
+
+void Lockout_recordSuccess(void)
+{
+	if (g_state.attempts != 0 || g_state.level != 0)
+	{
+		g_state.attempts = 0;
+		g_state.level = 0;
+		Lockout_save();
+	}
+}
+
+boolean Lockout_service(void)
+{
+	if (g_state.remaining == 0 || Systick_elapsedSince(g_lastTick) < 1000)
+	{
+		return FALSE;
+	}
+	g_lastTick += 1000;
+	g_state.remaining--;
+	if (g_state.remaining % LOCKOUT_SAVE_INTERVAL == 0)
+	{
+		Lockout_save();
+	}
+	return (g_state.remaining == 0) ? TRUE : FALSE;
+}
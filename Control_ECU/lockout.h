@@ -0,0 +1,92 @@
+ /******************************************************************************
+ *
+ * Module: Lockout
+ *
+ * File Name: lockout.h
+ *
+ * Description: Header file for the failed password lockout of Control_ECU.
+ *              Failures in a row start a lockout whose length grows with
+ *              each lockout in a row, from a policy table. The state is
+ *              kept in the external EEPROM, so a reset neither clears the
+ *              failures nor ends a lockout early; a record failing its
+ *              version or CRC check starts a first length lockout.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef LOCKOUT_H_
+#define LOCKOUT_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define LOCKOUT_LEVELS  6
+
+/* Lockout policy */
+typedef struct
+{
+    uint8 attemptsLimit;              // Failures in a row that start a lockout
+    uint16 seconds[LOCKOUT_LEVELS];   // Length of the 1st, 2nd... lockout in a row; the last one repeats
+} Lockout_PolicyType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Register the policy and load the saved state, resuming a lockout cut
+ * short by a reset. Needs the EEPROM buffer and the systick.
+ */
+void Lockout_init(const Lockout_PolicyType *policy);
+
+/*
+ * Description :
+ * Replace the policy. A running lockout keeps its length, the failures
+ * already counted still count.
+ */
+void Lockout_setPolicy(const Lockout_PolicyType *policy);
+
+/*
+ * Description :
+ * TRUE while locked out.
+ */
+boolean Lockout_isActive(void);
+
+/*
+ * Description :
+ * Seconds of lockout left, 0 if not locked out.
+ */
+uint16 Lockout_getRemaining(void);
+
+/*
+ * Description :
+ * Failures still allowed before the next lockout.
+ */
+uint8 Lockout_getAttemptsLeft(void);
+
+/*
+ * Description :
+ * Count a wrong password. Returns TRUE if it started a lockout (or one is
+ * already running, then nothing is counted).
+ */
+boolean Lockout_recordFailure(void);
+
+/*
+ * Description :
+ * Count a right password: clears the failures and the escalation.
+ */
+void Lockout_recordSuccess(void);
+
+/*
+ * Description :
+ * Count the lockout down; call it from the idle loop. Returns TRUE once,
+ * when the lockout ends.
+ */
+boolean Lockout_service(void);
+
+#endif /* LOCKOUT_H_ */
@@ -11,35 +11,120 @@
 #include <avr/io.h>
 #include "uart.h"
 #include "external_eeprom.h"
+#include "eeprom_buffer.h"
 #include "motor.h"
 #include "buzzer.h"
 #include "pir.h"
 #include "std_types.h"
 #include "twi.h"
 #include "timer.h"
+#include "systick.h"
+#include "idle.h"
+#include "profile.h"
+#include "stack_monitor.h"
+#include "command.h"
+#include "autobaud.h"
+#include "link.h"
+#include "speck.h"
+#include "cmac.h"
+#include "keystore.h"
+#include "credential.h"
+#include "lockout.h"
+#include "config.h"
+#include "power_monitor.h"
+#include "adc.h"
 #include <avr/interrupt.h>
+#include <avr/wdt.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
+#include <util/crc16.h>
+#include <string.h>
 
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
-#define PASSWORD_LENGTH 5
-#define EEPROM_ADDRESS 0x0311
+#define PASSWORD_MIN_LENGTH 4
+#define PASSWORD_MAX_LENGTH 10
+#define EEPROM_ADDRESS 0x0311         // Tag of the password (CREDENTIAL_TAG_SIZE bytes) then its length, never the password itself
 #define START_COMMUNICATION 0x15
 #define COMMAND_OPEN_DOOR '+'
 #define COMMAND_CHANGE_PASSWORD '-'
-#define WAIT_MESSAGE_COMMAND 0x20
-#define ATTEMPTS_LIMIT 3
-#define TRY_AGAIN 0x11
+#define COMMAND_SETTINGS 0x3B          // Password check that unlocks CONFIG_SET_COMMAND
+#define DOOR_EVENT_COMMAND 0x21
+#define DIAG_COMMAND 0x30              // Profiler report request, PROFILE_ENABLE builds only
+#define DIAG_CHUNK_LENGTH (LINK_MAX_PAYLOAD - 2)  // Report bytes per reply: DIAG_COMMAND, offset, then the bytes
+#define LINK_BENCH_COMMAND 0x34        // Link benchmark exchange, UART_FAULT_ENABLE builds only
+#define LINK_STATUS_COMMAND 0x35       // Receive error and link counters request
+#define PAIR_COMMAND 0x36              // Link key request, answered only until HMI_ECU proves it holds the key
+#define LOCKOUT_STATUS_COMMAND 0x38    // Lockout state request
+#define LOCKOUT_STATUS_LENGTH 4        // Reply: LOCKOUT_STATUS_COMMAND, little-endian uint16 seconds left, attempts left
+#define DIGIT_COMMAND 0x37             // One password digit as it is typed: START_COMMUNICATION, position, digit
+#define CONFIG_GET_COMMAND 0x39        // Installer settings request
+#define CONFIG_GET_LENGTH (1 + 2 * CONFIG_FIELDS)  // Reply: CONFIG_GET_COMMAND, then the fields as little-endian uint16
+#define CONFIG_SET_COMMAND 0x3A        // Change one setting: START_COMMUNICATION, field, value low, value high
+#define PASSWORD_STATUS_COMMAND 0x3C  // Password stored request, reply 1 or 0
+#define SETTINGS_UNLOCK_TIME 60000     // ms after COMMAND_SETTINGS or the last change before settings lock again
+#define LINK_STATUS_LENGTH 15          // Reply: LINK_STATUS_COMMAND, then little-endian uint16 framing, overrun,
+                                       // parity, overflow, retransmits, failures, badFrames
+#define BUZZER_PRIORITY_FEEDBACK 1     // Chirps and beeps acknowledging a password
+#define BUZZER_PRIORITY_ALARM 2        // Lockout alarm
+#define PASSWORD_LOCKED 2              // Password verdict: locked out, nothing was checked or this failure started the lockout
+#define PASSWORD_MESSAGE_LENGTH (PASSWORD_MAX_LENGTH + 2)  // START, length, digits
+
+#if (COMMAND_FRAME_START != START_COMMUNICATION)
+#error "The command dispatcher must sync on START_COMMUNICATION"
+#endif
+#if (PASSWORD_MESSAGE_LENGTH > LINK_MAX_PAYLOAD)
+#error "The password creation message does not fit in a link frame"
+#endif
+#if (KEYSTORE_KEY_LENGTH > LINK_MAX_PAYLOAD)
+#error "The link key must fit in the PAIR_COMMAND reply"
+#endif
+#if (CONFIG_GET_LENGTH > LINK_MAX_PAYLOAD)
+#error "The settings must fit in the CONFIG_GET_COMMAND reply"
+#endif
+#define DOOR_RAMP_SHAPE MOTOR_RAMP_SCURVE
+#define DOOR_PEAK_DUTY 100             // Cruise duty cycle in percent
+#define DOOR_EVENT_INTERVAL 1000       // Minimum ms between two progress events
+
+/* Progress events sent as DOOR_EVENT_COMMAND, event, value */
+#define EVENT_DOOR_OPENING 0x01        // value = percent of travel done
+#define EVENT_DOOR_HOLDING 0x02        // Motion detected, door held open
+#define EVENT_DOOR_CLOSING 0x03        // value = percent of travel done
+#define EVENT_DOOR_LOCKED 0x04         // Door cycle finished
+#define CHECKPOINT_ADDRESS 0x0300      // Page aligned, one page holds the whole record
+#define CHECKPOINT_MAGIC 0xC7
+#define KEY_ENTROPY_SAMPLES 64         // ADC and timer samples conditioned into each half of a new link key
+#define PAIR_BUTTON_PORT PORTB_ID      // Pairing button to ground, held at power-up to hand the link key to a new HMI_ECU
+#define PAIR_BUTTON_PIN PIN0_ID
+#define PAIR_WINDOW_TIME 60000         // ms after power-up the key may be handed out, if the button was held
+
+/*******************************************************************************
+ *                               Types Declaration                             *
+ *******************************************************************************/
+
+typedef enum {
+	DOOR_LOCKED,
+	DOOR_OPENING,
+	DOOR_OPEN,
+	DOOR_CLOSING
+} DoorStateType;
+
+/* State saved by the power-fail handler, must fit in one EEPROM page */
+typedef struct {
+	uint8 magic;           // CHECKPOINT_MAGIC when the record is valid
+	uint8 doorState;       // DoorStateType at the time of the power fail
+	uint8 motorDirection;  // DcMotor_State at the time of the power fail
+	uint8 travelTime;      // Seconds the motor had been running in the current travel
+	uint8 pendingBytes;    // EEPROM bytes that were still staged in RAM
+	uint16 crc;
+} DoorCheckpointType;
 
 /*******************************************************************************
  *                           Global Variables                                  *
  *******************************************************************************/
 
-uint8 savedPassword[PASSWORD_LENGTH];
-uint8 enteredPassword[PASSWORD_LENGTH];
-uint8 attempts = 0;
 
 
 
@@ -49,11 +134,37 @@ uint8 attempts = 0;
 void initializeSystem();
 void unlockDoor();
 void lockDoor();
-void receiveAndVerifyPasswords();
-void receiveAndVerifyPasswordForOperation(uint8 command);
-void savePasswordToEEPROM(uint8 *password);
-void readPasswordFromEEPROM(uint8 *password);
-void handleFailedAttempts();
+void receiveNewPassword();
+uint8 verifyPasswordCommand(const uint8 *args);
+uint8 digitCommand(const uint8 *args);
+void openDoorComplete(uint8 reply);
+void changePasswordComplete(uint8 reply);
+void settingsComplete(uint8 reply);
+void signalVerdict(uint8 reply);
+#if PROFILE_ENABLE
+uint8 diagCommand(const uint8 *args);
+#endif
+#if UART_FAULT_ENABLE
+uint8 benchCommand(const uint8 *args);
+#endif
+uint8 linkStatusCommand(const uint8 *args);
+uint8 pairCommand(const uint8 *args);
+uint8 lockoutStatusCommand(const uint8 *args);
+uint8 configGetCommand(const uint8 *args);
+uint8 configSetCommand(const uint8 *args);
+uint8 passwordStatusCommand(const uint8 *args);
+void getLockoutPolicy(Lockout_PolicyType *policy);
+void setupLinkKey(void);
+void generateLinkKey(uint8 *key);
+void saveCredentialToEEPROM(const uint8 *tag, uint8 length);
+uint8 readCredentialFromEEPROM(uint8 *tag);
+DcMotor_StopReason moveDoor(DoorStateType movingState, DcMotor_State direction, uint8 seconds, boolean report);
+void relink(uint8 first);
+uint8 receiveMessage(uint8 *message);
+void sendDoorEvent(uint8 event, uint8 value);
+void powerFailHandler(void);
+void restoreCheckpoint(void);
+uint16 checkpointCrc(const DoorCheckpointType *checkpoint);
 
 #endif /* CONTROL_MAIN_H_ */
 
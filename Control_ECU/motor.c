@@ -6,34 +6,60 @@
  */
 
 #include "motor.h"
+#include "adc.h"
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
 
-// Initialize the DC Motor (set direction pins and stop the motor initially)
-void DcMotor_Init(void)
-{
-	// Set Motor Control Pins as output
-	GPIO_setupPinDirection(MOTOR_CTRL_PORT_1,MOTOR_CTRL_PIN_1,PIN_OUTPUT);
-	GPIO_setupPinDirection(MOTOR_CTRL_PORT_2,MOTOR_CTRL_PIN_2,PIN_OUTPUT);
-	GPIO_setupPinDirection(MOTOR_PWM_PORT,MOTOR_PWM_PIN,PIN_OUTPUT);
+typedef enum {
+	PROFILE_IDLE,
+	PROFILE_ACCEL,
+	PROFILE_CRUISE,
+	PROFILE_DECEL
+} DcMotor_ProfilePhase;
 
-	// Stop the motor initially
-	GPIO_writePin(MOTOR_CTRL_PORT_1,MOTOR_CTRL_PIN_1,LOGIC_LOW);
-	GPIO_writePin(MOTOR_CTRL_PORT_2,MOTOR_CTRL_PIN_2,LOGIC_LOW);
+/* Smoothstep 3x^2 - 2x^3 sampled at 32 points, scaled to 0..255 */
+static const uint8 g_sCurve[32] PROGMEM = {
+	0, 1, 3, 7, 12, 18, 25, 33, 42, 52, 62, 74, 85, 97, 109, 121,
+	134, 146, 158, 170, 181, 193, 203, 213, 222, 230, 237, 243, 248, 252, 254, 255
+};
 
-}
+/* Profile state shared with the Timer0 overflow interrupt */
+static volatile DcMotor_ProfilePhase g_phase = PROFILE_IDLE;
+static volatile uint16 g_segmentTicks;  // Ticks left in the current phase
+static uint16 g_rampTicks;
+static uint16 g_cruiseTicks;
+static uint16 g_rampPos;                // Ramp position, 0 .. 0xFFFF
+static uint16 g_rampStep;               // Ramp position increment per tick
+static uint8 g_peakDuty;
+static DcMotor_RampType g_rampType;
+static volatile uint16 g_profileTicks;  // Ticks since the profile started
+static uint16 g_totalTicks;             // Planned length of the whole profile
+static uint16 g_blankTicks;             // Inrush blanking at start
 
+/* Current sensing state, updated from the ADC interrupt */
+static volatile DcMotor_StopReason g_stopReason = MOTOR_STOP_PROFILE_END;
+static volatile uint16 g_currentFilter;  // Exponential average, 8 x counts
+static uint8 g_overCurrentCount;
 
+static uint16 DcMotor_msToTicks(uint16 ms)
+{
+	return (uint16)(((uint32)ms * 1000UL) / PWM_getPeriodUs(MOTOR_PWM_CHANNEL));
+}
 
-void DcMotor_Rotate(DcMotor_State state, uint8 speed)
+/* Duty cycle for the current ramp position */
+static uint8 DcMotor_rampDuty(void)
 {
-	// Ensure speed is between 0 and 100
-	if (speed > 100)
+	uint8 fraction = g_rampPos >> 8;
+
+	if (g_rampType == MOTOR_RAMP_SCURVE)
 	{
-		speed = 100;
+		fraction = pgm_read_byte(&g_sCurve[fraction >> 3]);
 	}
+	return (uint8)(((uint16)g_peakDuty * fraction) >> 8);
+}
 
-	// Set the duty cycle for the PWM
-	PWM_Timer0_Start(speed);
-
+static void DcMotor_setDirection(DcMotor_State state)
+{
 	switch (state)
 	{
 	case CW:
@@ -44,8 +70,8 @@ void DcMotor_Rotate(DcMotor_State state, uint8 speed)
 
 	case ACW:
 		// Set control pins for anti-clockwise rotation
-		GPIO_writePin(MOTOR_CTRL_PORT_1,MOTOR_CTRL_PIN_1,LOGIC_LOW);
-		GPIO_writePin(MOTOR_CTRL_PORT_2,MOTOR_CTRL_PIN_2,LOGIC_HIGH);
+		GPIO_writePin(MOTOR_CTRL_PORT_1,MOTOR_CTRL_PIN_1,LOGIC_HIGH);
+		GPIO_writePin(MOTOR_CTRL_PORT_2,MOTOR_CTRL_PIN_2,LOGIC_LOW);
 		break;
 
 	case STOP:
@@ -55,8 +81,181 @@ void DcMotor_Rotate(DcMotor_State state, uint8 speed)
 		GPIO_writePin(MOTOR_CTRL_PORT_2,MOTOR_CTRL_PIN_2,LOGIC_LOW);
 		break;
 	}
+}
+
+/* Stop the running profile at once, from interrupt context */
+static void DcMotor_abortProfile(DcMotor_StopReason reason)
+{
+	g_phase = PROFILE_IDLE;
+	g_stopReason = reason;
+	DcMotor_setDirection(STOP);
+	PWM_setDuty(MOTOR_PWM_CHANNEL, 0);
+	PWM_setCallBack(NULL_PTR, MOTOR_PWM_CHANNEL);
+}
+
+/* Called from the ADC interrupt with every motor current sample */
+static void DcMotor_currentSample(uint16 value)
+{
+	/* First order low-pass, time constant of 8 samples */
+	g_currentFilter = g_currentFilter - (g_currentFilter >> 3) + value;
 
+	if (g_phase == PROFILE_IDLE || g_profileTicks < g_blankTicks)
+	{
+		g_overCurrentCount = 0;
+		return;
+	}
+
+	if ((g_currentFilter >> 3) < MOTOR_CURRENT_LIMIT)
+	{
+		g_overCurrentCount = 0;
+	}
+	else if (++g_overCurrentCount >= MOTOR_CURRENT_CONFIRM)
+	{
+		/*
+		 * Only the last part of the expected travel counts as the end stop;
+		 * anything earlier is an obstruction, so the caller retries instead
+		 * of reporting a door that is still partly open as locked
+		 */
+		if (g_profileTicks >= (uint16)(((uint32)g_totalTicks * MOTOR_END_ZONE_PERCENT) / 100))
+		{
+			DcMotor_abortProfile(MOTOR_STOP_END_OF_TRAVEL);
+		}
+		else
+		{
+			DcMotor_abortProfile(MOTOR_STOP_STALL);
+		}
+	}
 }
 
+/* Called from the PWM timer overflow interrupt, once per PWM period */
+static void DcMotor_profileTick(void)
+{
+	g_profileTicks++;
+
+	/* Move on to the next phase when the current one is over */
+	while (g_segmentTicks == 0)
+	{
+		switch (g_phase)
+		{
+		case PROFILE_ACCEL:
+			g_phase = PROFILE_CRUISE;
+			g_segmentTicks = g_cruiseTicks;
+			break;
+		case PROFILE_CRUISE:
+			g_phase = PROFILE_DECEL;
+			g_segmentTicks = g_rampTicks;
+			break;
+		default:
+			/* End of the profile: brake and release the interrupt */
+			DcMotor_abortProfile(MOTOR_STOP_PROFILE_END);
+			return;
+		}
+	}
+	g_segmentTicks--;
 
+	switch (g_phase)
+	{
+	case PROFILE_ACCEL:
+		g_rampPos += g_rampStep;
+		PWM_setDuty(MOTOR_PWM_CHANNEL, DcMotor_rampDuty());
+		break;
+	case PROFILE_CRUISE:
+		PWM_setDuty(MOTOR_PWM_CHANNEL, g_peakDuty);
+		break;
+	default:
+		g_rampPos -= g_rampStep;
+		PWM_setDuty(MOTOR_PWM_CHANNEL, DcMotor_rampDuty());
+		break;
+	}
+}
 
+// Initialize the DC Motor (set direction pins and stop the motor initially)
+void DcMotor_Init(void)
+{
+	// Set Motor Control Pins as output
+	GPIO_setupPinDirection(MOTOR_CTRL_PORT_1,MOTOR_CTRL_PIN_1,PIN_OUTPUT);
+	GPIO_setupPinDirection(MOTOR_CTRL_PORT_2,MOTOR_CTRL_PIN_2,PIN_OUTPUT);
+
+	// Start the PWM carrier once, afterwards only the duty cycle is updated
+	PWM_ConfigType pwmConfig = {MOTOR_PWM_CHANNEL, MOTOR_PWM_FREQUENCY};
+	PWM_init(&pwmConfig);
+
+	// Stop the motor initially
+	GPIO_writePin(MOTOR_CTRL_PORT_1,MOTOR_CTRL_PIN_1,LOGIC_LOW);
+	GPIO_writePin(MOTOR_CTRL_PORT_2,MOTOR_CTRL_PIN_2,LOGIC_LOW);
+
+	// Sample the shunt current as part of the ADC scan
+	ADC_setCallBack(DcMotor_currentSample, MOTOR_CURRENT_CHANNEL);
+
+}
+
+
+
+void DcMotor_Rotate(DcMotor_State state, uint8 speed)
+{
+	// A direct command always overrides a running profile
+	PWM_setCallBack(NULL_PTR, MOTOR_PWM_CHANNEL);
+	if (g_phase != PROFILE_IDLE)
+	{
+		g_phase = PROFILE_IDLE;
+		g_stopReason = MOTOR_STOP_CANCELLED;
+	}
+
+	// Ensure speed is between 0 and 100
+	if (speed > 100)
+	{
+		speed = 100;
+	}
+
+	// Set the duty cycle for the PWM
+	PWM_setDuty(MOTOR_PWM_CHANNEL, speed);
+
+	DcMotor_setDirection(state);
+}
+
+void DcMotor_startProfile(DcMotor_State state, const DcMotor_ProfileType *profile)
+{
+	PWM_setCallBack(NULL_PTR, MOTOR_PWM_CHANNEL);
+
+	g_rampType = profile->ramp;
+	g_peakDuty = (profile->peak_duty > 100) ? 100 : profile->peak_duty;
+	g_rampTicks = DcMotor_msToTicks(profile->ramp_time);
+	g_cruiseTicks = DcMotor_msToTicks(profile->cruise_time);
+	g_rampStep = (g_rampTicks != 0) ? (0xFFFF / g_rampTicks) : 0;
+	g_rampPos = 0;
+	g_profileTicks = 0;
+	g_totalTicks = 2 * g_rampTicks + g_cruiseTicks;
+	g_blankTicks = DcMotor_msToTicks(MOTOR_INRUSH_BLANK_TIME);
+	g_overCurrentCount = 0;
+	g_stopReason = MOTOR_STOP_NONE;
+
+	// Start from standstill, the interrupt takes over from the first period
+	PWM_setDuty(MOTOR_PWM_CHANNEL, 0);
+	DcMotor_setDirection(state);
+	g_phase = PROFILE_ACCEL;
+	g_segmentTicks = g_rampTicks;
+	PWM_setCallBack(DcMotor_profileTick, MOTOR_PWM_CHANNEL);
+}
+
+boolean DcMotor_isProfileDone(void)
+{
+	return (g_phase == PROFILE_IDLE) ? TRUE : FALSE;
+}
+
+DcMotor_StopReason DcMotor_getStopReason(void)
+{
+	return g_stopReason;
+}
+
+uint16 DcMotor_getCurrent(void)
+{
+	uint16 current;
+
+	uint8 sreg = SREG;
+
+	// 16-bit value shared with the ADC interrupt
+	cli();
+	current = g_currentFilter;
+	SREG = sreg;
+	return current >> 3;
+}
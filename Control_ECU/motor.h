@@ -10,6 +10,7 @@
 
 #include <avr/io.h>
 #include "gpio.h"
+#include "pwm.h"
 #include "std_types.h"
 /*******************************************************************************
  *                                Definitions                                  *
@@ -31,9 +32,36 @@ typedef enum {
 #define MOTOR_CTRL_PORT_2    PORTD_ID
 #define MOTOR_CTRL_PIN_2     PIN7_ID
 
-// Motor PWM Pin Configuration (Assume Timer0 OC0 pin)
-#define MOTOR_PWM_PORT       PORTB_ID
-#define MOTOR_PWM_PIN        PIN3_ID
+// Motor PWM Configuration (Timer0 OC0 pin, PB3); motion profile updates run once per PWM period
+#define MOTOR_PWM_CHANNEL    PWM_CHANNEL_OC0
+#define MOTOR_PWM_FREQUENCY  488   // Hz, F_CPU/64/256 at 8MHz
+
+// Motor current sense: 0.1 ohm shunt on ADC0 (PA0), 2.5 mV = 25 mA per count
+#define MOTOR_CURRENT_CHANNEL    0
+#define MOTOR_CURRENT_LIMIT      48    // Filtered counts (~1.2 A) treated as a blocked rotor
+#define MOTOR_CURRENT_CONFIRM    24    // Consecutive samples above the limit (~10 ms)
+#define MOTOR_INRUSH_BLANK_TIME  200   // ms after start during which the limit is ignored
+#define MOTOR_END_ZONE_PERCENT   90    // Blocked after this much of the profile = end stop reached, earlier = stall
+
+typedef enum {
+    MOTOR_STOP_NONE,           // Profile still running
+    MOTOR_STOP_PROFILE_END,    // Profile ran to completion without reaching an end stop
+    MOTOR_STOP_END_OF_TRAVEL,  // Current rose at the end of the travel
+    MOTOR_STOP_STALL,          // Current rose early: obstruction
+    MOTOR_STOP_CANCELLED       // DcMotor_Rotate() took over
+} DcMotor_StopReason;
+
+typedef enum {
+    MOTOR_RAMP_TRAPEZOID,  // Linear acceleration and deceleration
+    MOTOR_RAMP_SCURVE      // Smoothstep ramp, no jerk at either end of the ramp
+} DcMotor_RampType;
+
+typedef struct {
+    DcMotor_RampType ramp;  // Ramp shape used for both acceleration and deceleration
+    uint8 peak_duty;        // Cruise duty cycle in percent
+    uint16 ramp_time;       // Acceleration (and deceleration) time in ms
+    uint16 cruise_time;     // Time spent at peak_duty in ms
+} DcMotor_ProfileType;
 
 
 /*******************************************************************************
@@ -43,4 +71,29 @@ void DcMotor_Init(void);
 
 void DcMotor_Rotate(DcMotor_State state, uint8 speed);
 
+/*
+ * Start a ramp-up / cruise / ramp-down move in the given direction and return
+ * immediately. The duty cycle is updated from the Timer0 overflow interrupt
+ * and the motor is stopped at the end of the profile. Any DcMotor_Rotate()
+ * call cancels a running profile.
+ */
+void DcMotor_startProfile(DcMotor_State state, const DcMotor_ProfileType *profile);
+
+/*
+ * Return TRUE once the last started profile has finished (or was cancelled).
+ */
+boolean DcMotor_isProfileDone(void);
+
+/*
+ * Return why the last profile stopped. While a profile runs, the filtered
+ * motor current is checked on every ADC sample and the motor is stopped at
+ * once when it stays above MOTOR_CURRENT_LIMIT.
+ */
+DcMotor_StopReason DcMotor_getStopReason(void);
+
+/*
+ * Return the filtered motor current in ADC counts.
+ */
+uint16 DcMotor_getCurrent(void);
+
 #endif /* MOTOR_H_ */
@@ -0,0 +1,50 @@
+ /******************************************************************************
+ *
+ * Module: Power Monitor
+ *
+ * File Name: power_monitor.c
+ *
+ * Description: Source file for the brown-out detector of Control_ECU
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "power_monitor.h"
+#include "adc.h"
+
+/* Function called from the ADC interrupt */
+static void (*g_powerFailCallBackPtr)(void) = NULL_PTR;
+
+/* Last supply sample, written by the ADC interrupt */
+static volatile uint16 g_supplySample = ADC_MAX_VALUE;
+
+/* Called from the ADC interrupt with every supply sample */
+static void PowerMonitor_sample(uint16 value)
+{
+	g_supplySample = value;
+	if (value < POWER_SENSE_THRESHOLD && g_powerFailCallBackPtr != NULL_PTR) {
+		(*g_powerFailCallBackPtr)();
+	}
+}
+
+void PowerMonitor_init(void)
+{
+	ADC_setCallBack(PowerMonitor_sample, POWER_SENSE_CHANNEL);
+}
+
+void PowerMonitor_setCallBack(void(*a_ptr)(void))
+{
+	g_powerFailCallBackPtr = a_ptr;
+}
+
+boolean PowerMonitor_isLow(void)
+{
+	return (g_supplySample < POWER_SENSE_THRESHOLD) ? TRUE : FALSE;
+}
+
+void PowerMonitor_waitForRecovery(void)
+{
+	/* Hysteresis so a supply hovering at the threshold does not bounce */
+	while ((g_supplySample = ADC_readChannel(POWER_SENSE_CHANNEL)) < POWER_SENSE_RECOVERY);
+}
@@ -0,0 +1,66 @@
+ /******************************************************************************
+ *
+ * Module: Power Monitor
+ *
+ * File Name: power_monitor.h
+ *
+ * Description: Header file for the brown-out detector of Control_ECU.
+ *              The supply is divided down onto an ADC pin that is part of the
+ *              ADC scan; a sample below the threshold fires the power-fail
+ *              callback while there is still hold-up time left to save state.
+ *              At idle the supply is sampled every 2 ms by the slow scan.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef POWER_MONITOR_H_
+#define POWER_MONITOR_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * ADC channel carrying the divided supply (ADC1 = PA1). The divider is chosen
+ * so that this pin is at 1.23V at the brown-out threshold, well above the MCU
+ * minimum operating voltage.
+ */
+#define POWER_SENSE_CHANNEL 1
+
+/* Brown-out threshold and recovery level in ADC counts (1.23V and 1.30V at the pin) */
+#define POWER_SENSE_THRESHOLD 492
+#define POWER_SENSE_RECOVERY  520
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Add the sense channel to the ADC scan. ADC_init() must have been called.
+ */
+void PowerMonitor_init(void);
+
+/*
+ * Description :
+ * Register the function called from the interrupt when the supply drops.
+ */
+void PowerMonitor_setCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Return TRUE if the last supply sample was below the brown-out threshold.
+ */
+boolean PowerMonitor_isLow(void);
+
+/*
+ * Description :
+ * Stop the ADC scan and poll the supply until it is back above the recovery
+ * level. Works with interrupts disabled (boot and power-fail handler).
+ */
+void PowerMonitor_waitForRecovery(void);
+
+#endif /* POWER_MONITOR_H_ */
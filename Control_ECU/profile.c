@@ -0,0 +1,144 @@
+ /******************************************************************************
+ *
+ * Module: Profiler
+ *
+ * File Name: profile.c
+ *
+ * Description: Source file for the CPU load and ISR latency profiler
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "profile.h"
+
+#if PROFILE_ENABLE
+
+#include "systick.h"
+#include "idle.h"
+#include "stack_monitor.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#define PROFILE_US_PER_COUNT (SYSTICK_PRESCALER / (F_CPU / 1000000UL))
+
+/* Upper bounds of the loop histogram bins in us, the last bin is open ended */
+static const uint32 g_loopBinLimits[PROFILE_LOOP_BINS - 1] PROGMEM = {1000, 10000, 100000, 1000000};
+
+static Profile_IsrStatsType g_isrStats[PROFILE_NUM_OF_ISRS];
+static uint16 g_loopBins[PROFILE_LOOP_BINS];
+static uint32 g_lastLoopMark = 0;
+static boolean g_loopMarked = FALSE;
+
+uint16 Profile_isrEnter(void)
+{
+	return TCNT1;  /* Interrupts are masked inside an ISR, no TEMP register race */
+}
+
+void Profile_isrExit(Profile_IsrType isr, uint16 start)
+{
+	uint16 now = TCNT1;
+	uint16 counts;
+	uint16 us;
+
+	/* The tick cannot be serviced meanwhile, so TCNT1 wrapped at most once */
+	counts = (now >= start) ? (now - start) : (now + OCR1A + 1 - start);
+	us = counts * PROFILE_US_PER_COUNT;
+
+	g_isrStats[isr].calls++;
+	g_isrStats[isr].totalUs += us;
+	if (us > g_isrStats[isr].maxUs)
+	{
+		g_isrStats[isr].maxUs = us;
+	}
+}
+
+void Profile_loopMark(void)
+{
+	uint32 now = Systick_getMicros();
+	uint32 iteration = now - g_lastLoopMark;
+	uint8 bin;
+
+	if (g_loopMarked)
+	{
+		for (bin = 0; bin < PROFILE_LOOP_BINS - 1; bin++)
+		{
+			if (iteration < pgm_read_dword(&g_loopBinLimits[bin]))
+			{
+				break;
+			}
+		}
+		if (g_loopBins[bin] != 0xFFFF)
+		{
+			g_loopBins[bin]++;  /* Saturate instead of wrapping */
+		}
+	}
+	g_lastLoopMark = now;
+	g_loopMarked = TRUE;
+}
+
+void Profile_getIsrStats(Profile_IsrType isr, Profile_IsrStatsType *stats)
+{
+	uint8 sreg = SREG;
+
+	cli();
+	*stats = g_isrStats[isr];
+	SREG = sreg;
+}
+
+static uint8 *Profile_putWord(uint8 *report, uint16 value)
+{
+	*report++ = (uint8)value;
+	*report++ = (uint8)(value >> 8);
+	return report;
+}
+
+void Profile_getReport(uint8 *report)
+{
+	Profile_IsrStatsType stats;
+	Idle_StatsType idle;
+	uint8 i;
+
+	for (i = 0; i < PROFILE_NUM_OF_ISRS; i++)
+	{
+		Profile_getIsrStats(i, &stats);
+		report = Profile_putWord(report, (uint16)stats.calls);
+		report = Profile_putWord(report, (uint16)(stats.calls >> 16));
+		report = Profile_putWord(report, (stats.calls != 0) ? (uint16)(stats.totalUs / stats.calls) : 0);
+		report = Profile_putWord(report, stats.maxUs);
+	}
+	for (i = 0; i < PROFILE_LOOP_BINS; i++)
+	{
+		report = Profile_putWord(report, g_loopBins[i]);
+	}
+
+	Idle_getStats(&idle);
+	*report++ = idle.idlePercent;
+	report = Profile_putWord(report, idle.maxWakeLatencyUs);
+	Profile_putWord(report, StackMonitor_getFreeBytes());
+
+	Profile_reset();
+}
+
+void Profile_reset(void)
+{
+	uint8 i;
+	uint8 sreg = SREG;
+
+	cli();
+	for (i = 0; i < PROFILE_NUM_OF_ISRS; i++)
+	{
+		g_isrStats[i].calls = 0;
+		g_isrStats[i].totalUs = 0;
+		g_isrStats[i].maxUs = 0;
+	}
+	SREG = sreg;
+	for (i = 0; i < PROFILE_LOOP_BINS; i++)
+	{
+		g_loopBins[i] = 0;
+	}
+	g_loopMarked = FALSE;
+}
+
+#endif /* PROFILE_ENABLE */
@@ -6,29 +6,250 @@
  */
 
 #include"pwm.h"
+#include"timer.h"
+#include"common_macros.h"
+#include<avr/pgmspace.h>
 
+/* Duty cycle 0-100% as a fraction of TOP in Q8 (256 = 100%), saves a runtime divide */
+static const uint16 g_dutyToQ8[101] PROGMEM = {
+	0, 3, 5, 8, 10, 13, 15, 18, 20, 23, 26, 28, 31, 33, 36, 38, 41, 44, 46, 49,
+	51, 54, 56, 59, 61, 64, 67, 69, 72, 74, 77, 79, 82, 84, 87, 90, 92, 95, 97, 100,
+	102, 105, 108, 110, 113, 115, 118, 120, 123, 125, 128, 131, 133, 136, 138, 141, 143, 146, 148, 151,
+	154, 156, 159, 161, 164, 166, 169, 172, 174, 177, 179, 182, 184, 187, 189, 192, 195, 197, 200, 202,
+	205, 207, 210, 212, 215, 218, 220, 223, 225, 228, 230, 233, 236, 238, 241, 243, 246, 248, 251, 253,
+	256
+};
 
-void PWM_Timer0_Start(uint8 duty_cycle)
+/* Prescalers in clock select order for Timer0/Timer1 and for Timer2 */
+static const uint16 g_prescalers01[5] PROGMEM = {1, 8, 64, 256, 1024};
+static const uint16 g_prescalers2[7] PROGMEM = {1, 8, 32, 64, 128, 256, 1024};
+
+static uint16 g_timer1Top = 0;               // ICR1, shared by OC1A and OC1B
+static uint16 g_periodUs[PWM_NUM_OF_CHANNELS];
+static void (*g_periodCallBackPtr[PWM_NUM_OF_CHANNELS])(void);
+
+/* Timer behind a channel */
+static Timer_ID_Type PWM_timerOf(PWM_ChannelType channel)
+{
+	if (channel == PWM_CHANNEL_OC0)
+	{
+		return TIMER_0;
+	}
+	return (channel == PWM_CHANNEL_OC2) ? TIMER_2 : TIMER_1;
+}
+
+/* Output compare resource of a channel */
+static Timer_ResourceType PWM_outputOf(PWM_ChannelType channel)
+{
+	return (channel == PWM_CHANNEL_OC1B) ? TIMER_RES_OCB : TIMER_RES_OCA;
+}
+
+/*
+ * Pick the clock select of an 8-bit fast PWM timer giving the frequency
+ * closest to the request: f = F_CPU / (N * 256).
+ */
+static uint8 PWM_select8bitClock(uint32 frequency, const uint16 *prescalers, uint8 count, uint16 *periodUs)
+{
+	uint8 best = 0;
+	uint32 bestError = 0xFFFFFFFF;
+	uint8 i;
+
+	for (i = 0; i < count; i++)
+	{
+		uint16 n = pgm_read_word(&prescalers[i]);
+		uint32 f = F_CPU / ((uint32)n * 256UL);
+		uint32 error = (f > frequency) ? (f - frequency) : (frequency - f);
+
+		if (error < bestError)
+		{
+			bestError = error;
+			best = i;
+			*periodUs = (uint16)(((uint32)n * 256UL) / (F_CPU / 1000000UL));
+		}
+	}
+	return best + 1;
+}
+
+/* Connect (or disconnect for 0%) the compare output and write the compare value */
+static void PWM_writeCompare(PWM_ChannelType channel, uint8 duty_cycle)
+{
+	uint16 q8 = pgm_read_word(&g_dutyToQ8[duty_cycle]);
+
+	switch (channel)
+	{
+	case PWM_CHANNEL_OC0:
+		if (duty_cycle == 0) {
+			TCCR0 &= ~(1 << COM01);
+		} else {
+			OCR0 = (uint8)((255u * q8) >> 8);
+			TCCR0 |= (1 << COM01);
+		}
+		break;
+	case PWM_CHANNEL_OC1A:
+		if (duty_cycle == 0) {
+			TCCR1A &= ~(1 << COM1A1);
+		} else {
+			OCR1A = (uint16)(((uint32)g_timer1Top * q8) >> 8);
+			TCCR1A |= (1 << COM1A1);
+		}
+		break;
+	case PWM_CHANNEL_OC1B:
+		if (duty_cycle == 0) {
+			TCCR1A &= ~(1 << COM1B1);
+		} else {
+			OCR1B = (uint16)(((uint32)g_timer1Top * q8) >> 8);
+			TCCR1A |= (1 << COM1B1);
+		}
+		break;
+	case PWM_CHANNEL_OC2:
+		if (duty_cycle == 0) {
+			TCCR2 &= ~(1 << COM21);
+		} else {
+			OCR2 = (uint8)((255u * q8) >> 8);
+			TCCR2 |= (1 << COM21);
+		}
+		break;
+	}
+}
+
+boolean PWM_init(const PWM_ConfigType *Config_Ptr)
+{
+	uint8 i;
+	uint16 periodUs = 0;
+
+	if (Config_Ptr->frequency == 0 || Config_Ptr->channel >= PWM_NUM_OF_CHANNELS)
+	{
+		return FALSE;
+	}
+
+	/* The timebase and the output pin must not be used by another driver */
+	if (!Timer_claim(PWM_timerOf(Config_Ptr->channel),
+			TIMER_RES_CLOCK | PWM_outputOf(Config_Ptr->channel), TIMER_OWNER_PWM))
+	{
+		return FALSE;
+	}
+
+	switch (Config_Ptr->channel)
+	{
+	case PWM_CHANNEL_OC0:
+		// Fast PWM, output connected on the first non-zero duty
+		TCCR0 = (1 << WGM00) | (1 << WGM01) |
+				PWM_select8bitClock(Config_Ptr->frequency, g_prescalers01, 5, &periodUs);
+		OCR0 = 0;
+		GPIO_setupPinDirection(PORTB_ID,PIN3_ID,PIN_OUTPUT);
+		break;
+
+	case PWM_CHANNEL_OC1A:
+	case PWM_CHANNEL_OC1B:
+		// Phase correct PWM with TOP = ICR1: f = F_CPU / (2 * N * TOP)
+		for (i = 0; i < 5; i++)
+		{
+			uint16 n = pgm_read_word(&g_prescalers01[i]);
+			uint32 top = F_CPU / (2UL * n * Config_Ptr->frequency);
+
+			if (top <= 0xFFFF)
+			{
+				if (top < 2 || (g_timer1Top != 0 && g_timer1Top != (uint16)top))
+				{
+					return FALSE;  // Too fast, or OC1A/OC1B disagree on the carrier
+				}
+				g_timer1Top = (uint16)top;
+				periodUs = (uint16)((2UL * n * top) / (F_CPU / 1000000UL));
+				ICR1 = g_timer1Top;
+				TCCR1A = (TCCR1A & ((1 << COM1A1) | (1 << COM1B1))) | (1 << WGM11);
+				TCCR1B = (1 << WGM13) | (i + 1);
+				break;
+			}
+		}
+		if (i == 5)
+		{
+			return FALSE;  // Too slow even at F_CPU/1024
+		}
+		if (Config_Ptr->channel == PWM_CHANNEL_OC1A) {
+			OCR1A = 0;
+			GPIO_setupPinDirection(PORTD_ID,PIN5_ID,PIN_OUTPUT);
+		} else {
+			OCR1B = 0;
+			GPIO_setupPinDirection(PORTD_ID,PIN4_ID,PIN_OUTPUT);
+		}
+		break;
+
+	case PWM_CHANNEL_OC2:
+		TCCR2 = (1 << WGM20) | (1 << WGM21) |
+				PWM_select8bitClock(Config_Ptr->frequency, g_prescalers2, 7, &periodUs);
+		OCR2 = 0;
+		GPIO_setupPinDirection(PORTD_ID,PIN7_ID,PIN_OUTPUT);
+		break;
+	}
+
+	g_periodUs[Config_Ptr->channel] = periodUs;
+	return TRUE;
+}
+
+void PWM_setDuty(PWM_ChannelType channel, uint8 duty_cycle)
 {
 	if (duty_cycle > 100)
 	{
 		duty_cycle = 100;  // Clamp to 100 if value exceeds 100
 	}
-	else if (duty_cycle < 0)
+	PWM_writeCompare(channel, duty_cycle);
+}
+
+void PWM_deInit(PWM_ChannelType channel)
+{
+	PWM_setCallBack(NULL_PTR, channel);
+	Timer_release(PWM_timerOf(channel), PWM_outputOf(channel), TIMER_OWNER_PWM);
+	switch (channel)
 	{
-		duty_cycle = 0;    // Clamp to 0 if value is less than 0
+	case PWM_CHANNEL_OC0:
+		TCCR0 = 0;
+		Timer_release(TIMER_0, TIMER_RES_CLOCK, TIMER_OWNER_PWM);
+		break;
+	case PWM_CHANNEL_OC1A:
+	case PWM_CHANNEL_OC1B:
+		// Timer1 keeps running while the other output still uses it
+		TCCR1A &= (channel == PWM_CHANNEL_OC1A) ? ~(1 << COM1A1) : ~(1 << COM1B1);
+		if (!(TCCR1A & ((1 << COM1A1) | (1 << COM1B1))))
+		{
+			TCCR1A = 0;
+			TCCR1B = 0;
+			g_timer1Top = 0;
+			Timer_release(TIMER_1, TIMER_RES_CLOCK, TIMER_OWNER_PWM);
+		}
+		break;
+	case PWM_CHANNEL_OC2:
+		TCCR2 = 0;
+		Timer_release(TIMER_2, TIMER_RES_CLOCK, TIMER_OWNER_PWM);
+		break;
 	}
-	// Set OC0 (Pin B3) as output
-	 GPIO_setupPinDirection(PORTB_ID,PIN3_ID,PIN_OUTPUT);
+}
 
-	// Configure Timer0 for Fast PWM mode with non-inverting output
-	// Set WGM00 (Waveform Generation Mode) and WGM01 for Fast PWM, and COM01 for non-inverting
-	TCCR0 = (1 << WGM00) | (1 << WGM01) | (1 << COM01);
+uint16 PWM_getPeriodUs(PWM_ChannelType channel)
+{
+	return g_periodUs[channel];
+}
 
-	// Set the pre-scaler to F_CPU/64
-	TCCR0 |= (1 << CS01) | (1 << CS00);
+void PWM_setCallBack(void(*a_ptr)(void), PWM_ChannelType channel)
+{
+	Timer_ID_Type timer = PWM_timerOf(channel);
+	uint8 mask = (timer == TIMER_0) ? (1 << TOIE0) : (timer == TIMER_2) ? (1 << TOIE2) : (1 << TOIE1);
 
-	// Set the duty cycle (0-100%) by writing to OCR0
-	// OCR0 = (duty_cycle / 100) * 255
-	OCR0 = (duty_cycle * 255) / 100;
+	/* Replace only this channel's callback, other users of the timer keep theirs */
+	if (g_periodCallBackPtr[channel] != NULL_PTR)
+	{
+		Timer_removeCallBack(g_periodCallBackPtr[channel], timer);
+		g_periodCallBackPtr[channel] = NULL_PTR;
+	}
+
+	if (a_ptr != NULL_PTR && Timer_claim(timer, TIMER_RES_OVF, TIMER_OWNER_PWM) && Timer_addCallBack(a_ptr, timer))
+	{
+		g_periodCallBackPtr[channel] = a_ptr;
+		TIFR = mask;       // Drop a stale overflow flag
+		TIMSK |= mask;
+	}
+	else if (timer != TIMER_1 || (g_periodCallBackPtr[PWM_CHANNEL_OC1A] == NULL_PTR && g_periodCallBackPtr[PWM_CHANNEL_OC1B] == NULL_PTR))
+	{
+		TIMSK &= ~mask;
+		Timer_release(timer, TIMER_RES_OVF, TIMER_OWNER_PWM);
+	}
 }
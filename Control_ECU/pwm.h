@@ -12,7 +12,64 @@
 #include"std_types.h"
 #include"gpio.h"
 
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
 
-void PWM_Timer0_Start(uint8 duty_cycle);
+/* PWM outputs, the timer is implied by the output compare pin */
+typedef enum
+{
+    PWM_CHANNEL_OC0,   // Timer0, PB3, 8-bit fast PWM
+    PWM_CHANNEL_OC1A,  // Timer1, PD5, 16-bit phase correct PWM (TOP = ICR1)
+    PWM_CHANNEL_OC1B,  // Timer1, PD4, shares ICR1 (and frequency) with OC1A
+    PWM_CHANNEL_OC2    // Timer2, PD7, 8-bit fast PWM
+} PWM_ChannelType;
+
+#define PWM_NUM_OF_CHANNELS 4
+
+/* PWM configuration structure */
+typedef struct
+{
+    PWM_ChannelType channel;  // Output compare pin to drive
+    uint32 frequency;         // Carrier frequency in Hz, the closest reachable one is used
+} PWM_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Configure the timer behind the channel for the requested carrier frequency,
+ * set the pin as output and start with 0% duty. Both Timer1 channels must use
+ * the same frequency. Returns FALSE if the frequency cannot be reached.
+ */
+boolean PWM_init(const PWM_ConfigType *Config_Ptr);
+
+/*
+ * Description :
+ * Update the duty cycle (0-100%) of an initialised channel. Only the compare
+ * register is written; 0% disconnects the pin so the output is fully off.
+ */
+void PWM_setDuty(PWM_ChannelType channel, uint8 duty_cycle);
+
+/*
+ * Description :
+ * Stop the timer behind the channel and release the pin.
+ */
+void PWM_deInit(PWM_ChannelType channel);
+
+/*
+ * Description :
+ * Return the length of one PWM period of the channel in microseconds.
+ */
+uint16 PWM_getPeriodUs(PWM_ChannelType channel);
+
+/*
+ * Description :
+ * Register a function called once per PWM period of the channel (timer
+ * overflow interrupt), or pass NULL_PTR to disable the interrupt.
+ */
+void PWM_setCallBack(void(*a_ptr)(void), PWM_ChannelType channel);
 
 #endif /* PWM_H_ */
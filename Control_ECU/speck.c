@@ -0,0 +1,130 @@
+ /******************************************************************************
+ *
+ * Module: Speck
+ *
+ * File Name: speck.c
+ *
+ * Description: Source file for the Speck64/128 block cipher. Built with
+ *              -Os (see subdir.mk); the rotation by 3, which avr-gcc turns
+ *              into a 29-step shift loop, is written in assembly.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "speck.h"
+#include <string.h>
+#include <avr/pgmspace.h>
+
+/* Rotations by 8 are byte moves on AVR */
+#define SPECK_ROR8(x)   (((x) >> 8) | ((x) << 24))
+
+/* Key 1b1a1918 13121110 0b0a0908 03020100, plaintext 3b726574 7475432d, ciphertext 8c6fa548 454e028b */
+static const uint8 g_testKey[SPECK_KEY_SIZE] PROGMEM = {
+	0x00, 0x01, 0x02, 0x03, 0x08, 0x09, 0x0A, 0x0B, 0x10, 0x11, 0x12, 0x13, 0x18, 0x19, 0x1A, 0x1B
+};
+static const uint8 g_testPlain[SPECK_BLOCK_SIZE] PROGMEM = {0x2D, 0x43, 0x75, 0x74, 0x74, 0x65, 0x72, 0x3B};
+static const uint8 g_testCipher[SPECK_BLOCK_SIZE] PROGMEM = {0x8B, 0x02, 0x4E, 0x45, 0x48, 0xA5, 0x6F, 0x8C};
+
+/* Same key, nonce "Nonce!" 00: a passwords message, two blocks with the last one partial */
+static const uint8 g_testNonce[SPECK_NONCE_SIZE] PROGMEM = {0x4E, 0x6F, 0x6E, 0x63, 0x65, 0x21, 0x00};
+static const uint8 g_testCtrPlain[12] PROGMEM = {0x15, '1', '2', '3', '4', '5', 0x15, '1', '2', '3', '4', '5'};
+static const uint8 g_testCtrCipher[12] PROGMEM = {
+	0xFC, 0x8C, 0xF2, 0x53, 0x0D, 0xAF, 0xC2, 0x35, 0xC1, 0x9C, 0x7E, 0x3E
+};
+
+/* Rotate left by 3: three 1-bit rotations of 5 cycles each */
+static inline uint32 Speck_rol3(uint32 x)
+{
+#ifdef __AVR__
+	__asm__ (
+		"    lsl %A0\n    rol %B0\n    rol %C0\n    rol %D0\n    adc %A0, __zero_reg__\n"
+		"    lsl %A0\n    rol %B0\n    rol %C0\n    rol %D0\n    adc %A0, __zero_reg__\n"
+		"    lsl %A0\n    rol %B0\n    rol %C0\n    rol %D0\n    adc %A0, __zero_reg__\n"
+		: "+r" (x));
+	return x;
+#else
+	return (x << 3) | (x >> 29);
+#endif
+}
+
+void Speck_setKey(Speck_KeyType *ctx, const uint8 *key)
+{
+	uint32 k;
+	uint32 l[3];
+	uint8 i;
+
+	/* AVR is little-endian, like the byte order of the key */
+	memcpy(&k, key, sizeof(k));
+	memcpy(l, key + sizeof(k), sizeof(l));
+
+	for (i = 0; i < SPECK_ROUNDS; i++)
+	{
+		ctx->roundKeys[i] = k;
+		if (i == SPECK_ROUNDS - 1)
+		{
+			break;
+		}
+		/* The key schedule is the round function with the round number as key */
+		l[i % 3] = (SPECK_ROR8(l[i % 3]) + k) ^ i;
+		k = Speck_rol3(k) ^ l[i % 3];
+	}
+}
+
+void Speck_encrypt(const Speck_KeyType *ctx, uint8 *block)
+{
+	uint32 x;
+	uint32 y;
+	uint8 i;
+
+	memcpy(&y, block, sizeof(y));
+	memcpy(&x, block + sizeof(y), sizeof(x));
+	for (i = 0; i < SPECK_ROUNDS; i++)
+	{
+		x = (SPECK_ROR8(x) + y) ^ ctx->roundKeys[i];
+		y = Speck_rol3(y) ^ x;
+	}
+	memcpy(block, &y, sizeof(y));
+	memcpy(block + sizeof(y), &x, sizeof(x));
+}
+
+void Speck_ctr(const Speck_KeyType *ctx, const uint8 *nonce, uint8 *data, uint8 length)
+{
+	uint8 keystream[SPECK_BLOCK_SIZE];
+	uint8 counter = 0;
+	uint8 used = SPECK_BLOCK_SIZE;
+
+	while (length--)
+	{
+		if (used == SPECK_BLOCK_SIZE)
+		{
+			memcpy(keystream, nonce, SPECK_NONCE_SIZE);
+			keystream[SPECK_NONCE_SIZE] = counter++;
+			Speck_encrypt(ctx, keystream);
+			used = 0;
+		}
+		*data++ ^= keystream[used++];
+	}
+}
+
+boolean Speck_selfTest(void)
+{
+	Speck_KeyType ctx;
+	uint8 key[SPECK_KEY_SIZE];
+	uint8 block[SPECK_BLOCK_SIZE];
+	uint8 nonce[SPECK_NONCE_SIZE];
+	uint8 message[sizeof(g_testCtrPlain)];
+
+	memcpy_P(key, g_testKey, sizeof(key));
+	memcpy_P(block, g_testPlain, sizeof(block));
+	Speck_setKey(&ctx, key);
+	Speck_encrypt(&ctx, block);
+	if (memcmp_P(block, g_testCipher, sizeof(block)) != 0)
+	{
+		return FALSE;
+	}
+	memcpy_P(nonce, g_testNonce, sizeof(nonce));
+	memcpy_P(message, g_testCtrPlain, sizeof(message));
+	Speck_ctr(&ctx, nonce, message, sizeof(message));
+	return (memcmp_P(message, g_testCtrCipher, sizeof(message)) == 0) ? TRUE : FALSE;
+}
@@ -0,0 +1,73 @@
+ /******************************************************************************
+ *
+ * Module: System Tick
+ *
+ * File Name: systick.h
+ *
+ * Description: Header file for the 1 ms monotonic timebase on Timer1.
+ *              The compare value is split into an integer part and a
+ *              fractional part that is accumulated every tick, so the
+ *              clock has no long-term drift for any F_CPU.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef SYSTICK_H_
+#define SYSTICK_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Timer1 runs at F_CPU/64: 125 counts per ms and 8 us per count at 8MHz */
+#define SYSTICK_PRESCALER        64UL
+#define SYSTICK_COUNTS_PER_SEC   (F_CPU / SYSTICK_PRESCALER)
+#define SYSTICK_COUNTS_PER_MS    (SYSTICK_COUNTS_PER_SEC / 1000UL)
+#define SYSTICK_FRACTION_PER_MS  (SYSTICK_COUNTS_PER_SEC % 1000UL)  /* In 1/1000 count */
+
+#if (SYSTICK_COUNTS_PER_MS < 2) || (SYSTICK_COUNTS_PER_MS > 65535)
+#error "F_CPU out of range for the 1 ms system tick"
+#endif
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Claim Timer1 and start the 1 ms tick. Other users can share the tick with
+ * Timer_addCallBack(..., TIMER_1); they are called once per millisecond.
+ */
+void Systick_init(void);
+
+/*
+ * Description :
+ * Milliseconds since Systick_init(), read atomically. Wraps after ~49 days;
+ * compare times with Systick_elapsedSince() so the wrap is harmless.
+ */
+uint32 Systick_getMillis(void);
+
+/*
+ * Description :
+ * Microseconds since Systick_init() (tick count plus TCNT1), read atomically.
+ * Resolution is one timer count (8 us at 8MHz). Meant for profiling.
+ */
+uint32 Systick_getMicros(void);
+
+/*
+ * Description :
+ * Microseconds since the last tick, from TCNT1 alone. Meant for measuring
+ * how late code runs after a tick interrupt.
+ */
+uint16 Systick_getTickPhaseUs(void);
+
+/*
+ * Description :
+ * Milliseconds elapsed since a value returned by Systick_getMillis().
+ */
+uint32 Systick_elapsedSince(uint32 start);
+
+#endif /* SYSTICK_H_ */
@@ -103,3 +103,16 @@ uint8 TWI_getStatus(void)
     /* Masking to eliminate first 3 bits and get the last 5 bits (status bits) */
     return (TWSR & 0xF8);
 }
+
+void TWI_recover(void)
+{
+    uint8 timeout = 0xFF;
+
+    /*
+     * Used when the current transaction was interrupted (e.g. power fail):
+     * let a byte that is still on the wire finish, then release the bus with
+     * a stop condition so the next start is accepted by the slave.
+     */
+    while(BIT_IS_CLEAR(TWCR, TWINT) && --timeout);
+    TWI_stop();
+}
@@ -5,30 +5,78 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../HMI_ECU.c \
+../autobaud.c \
+../cmac.c \
+../config.c \
 ../gpio.c \
+../idle.c \
 ../keypad.c \
+../keystore.c \
 ../lcd.c \
+../link.c \
+../menu.c \
+../profile.c \
+../speck.c \
+../stack_monitor.c \
+../systick.c \
 ../timer.c \
 ../uart.c 
 
 OBJS += \
 ./HMI_ECU.o \
+./autobaud.o \
+./cmac.o \
+./config.o \
 ./gpio.o \
+./idle.o \
 ./keypad.o \
+./keystore.o \
 ./lcd.o \
+./link.o \
+./menu.o \
+./profile.o \
+./speck.o \
+./stack_monitor.o \
+./systick.o \
 ./timer.o \
 ./uart.o 
 
 C_DEPS += \
 ./HMI_ECU.d \
+./autobaud.d \
+./cmac.d \
+./config.d \
 ./gpio.d \
+./idle.d \
 ./keypad.d \
+./keystore.d \
 ./lcd.d \
+./link.d \
+./menu.d \
+./profile.d \
+./speck.d \
+./stack_monitor.d \
+./systick.d \
 ./timer.d \
 ./uart.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
+# The link cipher and MAC run on every frame: always optimized, whatever the configuration
+./cmac.o: ../cmac.c subdir.mk
+	@echo 'Building file: $<'
+	@echo 'Invoking: AVR Compiler'
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+./speck.o: ../speck.c subdir.mk
+	@echo 'Building file: $<'
+	@echo 'Invoking: AVR Compiler'
+	avr-gcc -Wall -g2 -gstabs -Os -fpack-struct -fshort-enums -ffunction-sections -fdata-sections -std=gnu99 -funsigned-char -funsigned-bitfields -mmcu=atmega32 -DF_CPU=8000000UL -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" -c -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
 %.o: ../%.c subdir.mk
 	@echo 'Building file: $<'
 	@echo 'Invoking: AVR Compiler'
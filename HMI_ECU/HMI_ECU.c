@@ -8,25 +8,45 @@
 // HMI_ECU.c
 #include "main.h"
 
-// Global variable to track time ticks for timer management
-volatile uint16 g_tick = 0;
+/*
+ * Main menu, kept in flash. A new operation is one more entry here: a label
+ * line, the key that selects it and the handler (or a submenu).
+ */
+static const char g_labelOpenDoor[] PROGMEM = "(+) Open Door";
+static const char g_labelChangePass[] PROGMEM = "(-) Change Pass";
 
-// Timer1 callback function to increment tick count
-void Timer1_callback(void) {
-	g_tick++;  // Increment the tick counter on each timer compare match
-}
+static const Menu_ItemType g_mainMenuItems[] PROGMEM = {
+	{g_labelOpenDoor, COMMAND_OPEN_DOOR, handleOperation, NULL_PTR},
+	{g_labelChangePass, COMMAND_CHANGE_PASSWORD, handleOperation, NULL_PTR},
+	{NULL_PTR, SETTINGS_KEY, handleSettings, NULL_PTR},  // Hidden, for installers
+	{NULL_PTR, DIAG_KEY, showDiagnostics, NULL_PTR},  // Hidden, for service
+#if UART_FAULT_ENABLE
+	{NULL_PTR, BENCH_KEY, runLinkBenchmark, NULL_PTR},  // Hidden, fault injection builds only
+#endif
+};
 
-// Timer setup function to initialize Timer1 with a 1-second interval
-void setupTimer1(void) {
-	Timer_ConfigType timerConfig = {0, 7812, TIMER_1, TIMER_CLOCK_1024, TIMER_COMPARE_MODE};  // Configuring timer for 1-second interval with 8MHz clock
-	Timer_init(&timerConfig);  // Initialize timer with specified configuration
-	Timer_setCallBack(Timer1_callback, TIMER_1);  // Set the callback function for Timer1
-}
+static const Menu_Type g_mainMenu PROGMEM = {
+	g_mainMenuItems, sizeof(g_mainMenuItems) / sizeof(g_mainMenuItems[0]), NULL_PTR
+};
 
-// Stop Timer1 function to deinitialize the timer
-void Timer1Stop(void) {
-	Timer_deInit(TIMER_1);  // Deinitialize Timer1 to stop it
-}
+/* Names of the installer settings, in field order */
+static const char g_labelTravel[] PROGMEM = "Travel time s";
+static const char g_labelRamp[] PROGMEM = "Ramp time ms";
+static const char g_labelRetries[] PROGMEM = "Stall retries";
+static const char g_labelAttempts[] PROGMEM = "Attempts limit";
+static const char g_labelLockout[] PROGMEM = "Lockout time s";
+static const char g_labelSplash[] PROGMEM = "Splash delay ms";
+static const char g_labelMessage[] PROGMEM = "Message time ms";
+
+static const char *const g_settingLabels[CONFIG_FIELDS] PROGMEM = {
+	[CONFIG_DOOR_TRAVEL_TIME] = g_labelTravel,
+	[CONFIG_DOOR_RAMP_TIME] = g_labelRamp,
+	[CONFIG_STALL_RETRIES] = g_labelRetries,
+	[CONFIG_ATTEMPTS_LIMIT] = g_labelAttempts,
+	[CONFIG_LOCKOUT_TIME] = g_labelLockout,
+	[CONFIG_SPLASH_DELAY] = g_labelSplash,
+	[CONFIG_MESSAGE_DELAY] = g_labelMessage,
+};
 
 int main(void) {
 	// Initialize system peripherals
@@ -34,32 +54,31 @@ int main(void) {
 	sei();  // Enable global interrupts
 
 	// Display initial screen with system information
-	LCD_displayString("Smart Door");
-	LCD_displayStringRowColumn(1, 0, "locking system");
-	_delay_ms(1000);  // Short delay for screen visibility
+	LCD_displayString_P(PSTR("Smart Door"));
+	LCD_displayStringRowColumn_P(1, 0, PSTR("locking system"));
+	Idle_delayMs(Config_get()->splashDelay);  // Short delay for screen visibility
 	LCD_clearScreen();
-	LCD_displayString("DONE BY:");
-	LCD_displayStringRowColumn(1, 0, "Mohamed Bahaa");
-	_delay_ms(1000);
+	LCD_displayString_P(PSTR("DONE BY:"));
+	LCD_displayStringRowColumn_P(1, 0, PSTR("Mohamed Bahaa"));
+	Idle_delayMs(Config_get()->splashDelay);
 
-	// Start password creation process
-	createPassword();
+	// Both ECUs boot at 9600 bps, then move to the fastest rate that passes the link test
+	relink();
+	setupLinkKey();  // Stored key, or collected from a Control_ECU not paired yet
+	fetchConfig();  // Control_ECU owns the settings, the stored copy is kept if it does not answer
+
+	// Control_ECU keeps the password across resets of either ECU, only a new system asks for one
+	if (queryPasswordSet()) {
+		isPasswordSet = 1;
+	} else {
+		createPassword();
+	}
 
 	while (1) {
+		PROFILE_LOOP_MARK();  // One iteration per menu selection
 		if (isPasswordSet) {
-			// Display main menu if password is set
-			mainMenu();
-			uint8 option = KEYPAD_getPressedKey();  // Get user input for menu option
-			_delay_ms(500);  // Debounce delay to avoid multiple key press detection
-
-			// Handle menu options for opening door or changing password
-			if (option == COMMAND_OPEN_DOOR || option == COMMAND_CHANGE_PASSWORD) {
-				handleOperation(option);
-			} else {
-				LCD_clearScreen();
-				LCD_displayStringRowColumn(1, 0, "Invalid Option");  // Invalid option feedback
-				_delay_ms(1000);
-			}
+			// Show the main menu and run the selected operation
+			Menu_run(&g_mainMenu);
 		} else {
 			// If password is not set, prompt to create password again
 			createPassword();
@@ -72,196 +91,719 @@ void initializeSystem() {
 	LCD_init();  // Initialize LCD for display
 	UART_ConfigType uartConfig = {8, 0, 1, 9600};  // UART configuration for 9600 baud rate
 	UART_init(&uartConfig);  // Initialize UART with specified configuration
+	Config_load();  // Settings copy from the last boot, or the defaults
+	Systick_init();  // 1 ms timebase shared with Control_ECU's timing code
+	if (Timer_hasConflict()) {
+		// Two drivers were configured on the same timer resource: stop here instead of misbehaving
+		LCD_displayString_P(PSTR("Timer conflict!"));
+		while (1);
+	}
+	if (!Speck_selfTest()) {
+		// A broken cipher would make every frame look forged
+		LCD_displayString_P(PSTR("Crypto fault!"));
+		while (1);
+	}
 }
 
 // Function to create and set the password
 void createPassword() {
-	while (1) {
-		// Get the two passwords from the user
-		enterPasswords(password1, password2);
+	uint8 message[PASSWORD_MESSAGE_LENGTH];
+	uint8 length;
+	uint8 match;
+	uint8 attempt;
 
-		// Send the entered passwords to Control_ECU for verification
-		UART_sendByte(START_COMMUNICATION);
-		for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-			UART_sendByte(password1[i]);  // Send first password
+	while (1) {
+		// Get the two passwords from the user, compared here
+		length = enterPasswords(password1, password2);
+		if (length == 0) {
+			// If passwords do not match, ask to try again
+			LCD_clearScreen();
+			LCD_displayString_P(PSTR("Mismatch!"));
+			LCD_displayStringRowColumn_P(1, 0, PSTR("Try Again"));
+			Idle_delayMs(Config_get()->messageDelay);
+			isPasswordSet = 0;  // Password setting failed, reset flag
+			continue;
 		}
-		UART_sendByte(START_COMMUNICATION);  // Send delimiter for second password
-		for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-			UART_sendByte(password2[i]);  // Send second password
+
+		// START_COMMUNICATION, length, digits
+		message[0] = START_COMMUNICATION;
+		message[1] = length;
+		for (uint8 i = 0; i < length; i++) {
+			message[i + 2] = password1[i];
 		}
 
-		// Receive the match result from Control_ECU
-		uint8 match = UART_recieveByte();
+		// Send the password to Control_ECU and receive the result; Control_ECU waits for it again after a relink
+		for (attempt = 0; attempt < PASSWORD_SEND_ATTEMPTS && !sendSecretRequest(message, length + 2, &match); attempt++) {
+			relink();
+		}
+		if (attempt == PASSWORD_SEND_ATTEMPTS) {
+			// Control_ECU is not waiting for a password (it missed the change password reply): the old one stays
+			LCD_clearScreen();
+			LCD_displayString_P(PSTR("Link failed!"));
+			LCD_displayStringRowColumn_P(1, 0, PSTR("Not changed"));
+			Idle_delayMs(Config_get()->messageDelay);
+			return;
+		}
+		if (match == PASSWORD_LOCKED) {
+			// Control_ECU was reset during a lockout: the new password waits for its end
+			waitForLockout();
+			continue;
+		}
 		if (match == 1) {
-			// If passwords match, password set successfully
+			// Password stored, password set successfully
 			LCD_clearScreen();
-			LCD_displayString("Password Set!");
-			_delay_ms(1000);
+			LCD_displayString_P(PSTR("Password Set!"));
+			Idle_delayMs(Config_get()->messageDelay);
 			isPasswordSet = 1;  // Mark password as set
 			break;
-		} else if (match == 0) {
-			// If passwords do not match, ask to try again
-			LCD_clearScreen();
-			LCD_displayString("Mismatch!");
-			LCD_displayStringRowColumn(1, 0, "Try Again");
-			_delay_ms(1000);
-			isPasswordSet = 0;  // Password setting failed, reset flag
-			UART_sendByte(TRY_AGAIN);  // Notify Control_ECU to retry
 		}
+		// Refused by Control_ECU (length out of its range): ask again
 	}
 }
 
-// Function to display the main menu for door operation options
-void mainMenu() {
-	LCD_clearScreen();
-	LCD_displayString("(+) Open Door");
-	LCD_displayStringRowColumn(1, 0, "(-) Change Pass");
-}
-
 // Function to handle door operation based on selected command (open door/change password)
 void handleOperation(uint8 command) {
-	attempts = 0;  // Reset failed attempts count
-	while (attempts < ATTEMPTS_LIMIT) {
-		// Prompt user to enter password
-		enterPassword(enteredPassword, "Enter Password:");
-		UART_sendByte(command);  // Send the selected command (open door or change password)
-		_delay_ms(100);  // Brief delay for synchronization
-		sendPasswordToControlECU(enteredPassword);  // Send the entered password to Control_ECU for verification
-
-		uint8 response = UART_recieveByte();  // Receive password verification response from Control_ECU
+	// Control_ECU counts the failures and decides when to lock out
+	while (1) {
+		// Prompt user to enter password, Control_ECU gets each digit as it is typed
+		uint8 length = enterPassword(PSTR("Enter Password:"));
+		if (length == ENTRY_CANCELLED) {
+			return;  // Back to the menu, not a failed attempt
+		}
+		if (length == ENTRY_LINK_FAILED) {
+			relink();  // Control_ECU missed digits: back to the menu
+			return;
+		}
+
+		// Send the command to Control_ECU, it finishes the check of the streamed digits and replies
+		uint8 response;
+		if (!sendPasswordToControlECU(command, length, &response)) {
+			relink();  // Control_ECU dropped the operation too: back to the menu
+			return;
+		}
 		if (response == 1) {
 			// If password is correct, perform operation (open door or change password)
 			LCD_clearScreen();
 			if (command == COMMAND_OPEN_DOOR) {
-				// If opening door, run the unlocking procedure
-				LCD_displayString("Door is");
-				LCD_moveCursor(1, 0);
-				LCD_displayString("Unlocking...");
-				setupTimer1();  // Start timer for unlocking operation
-				g_tick = 0;
-				while (g_tick < 15);  // Wait for 15 seconds for motor operation
-				g_tick = 0;
-				Timer1Stop();  // Stop timer
-				displayWaitMessage();  // Display message to wait while people enter
+				// If opening door, follow the progress reported by Control_ECU until the door is locked again
+				followDoorCycle();
 			} else if (command == COMMAND_CHANGE_PASSWORD) {
 				// If changing password, re-initiate password creation
 				createPassword();
+			} else if (command == COMMAND_SETTINGS) {
+				// Control_ECU accepts setting changes for a while after the password
+				editSettings();
 			}
 			return;
+		} else if (response == PASSWORD_LOCKED) {
+			// Too many failures, or a lockout is already running: lock the system
+			waitForLockout();
+			return;
 		} else {
-			// If password is incorrect, increment attempt counter and show error message
+			// If password is incorrect, show error message and the attempts left before a lockout
+			uint16 remaining;
+			uint8 attemptsLeft;
 			LCD_clearScreen();
-			LCD_displayString("Incorrect Pass!");
-			_delay_ms(500);
-			attempts++;
+			LCD_displayString_P(PSTR("Incorrect Pass!"));
+			if (queryLockout(&remaining, &attemptsLeft)) {
+				LCD_moveCursor(1, 0);
+				LCD_intgerToString(attemptsLeft);
+				LCD_displayString_P(PSTR(" tries left"));
+			}
+			Idle_delayMs(Config_get()->messageDelay);
 		}
 	}
-	// If failed attempts exceed the limit, lock the system
-	handleFailedAttempts();
 }
 
-// Function to handle system lockout after failed attempts
-void handleFailedAttempts() {
-	if (attempts >= ATTEMPTS_LIMIT) {
-		setupTimer1();  // Start timer for lockout duration
-		g_tick = 0;
+// Hidden menu item: the installer settings, behind the password like the other operations
+void handleSettings(uint8 key) {
+	handleOperation(COMMAND_SETTINGS);
+}
+
+// Ask Control_ECU for the lockout time left and the failures allowed before the next lockout, FALSE if no reply
+boolean queryLockout(uint16 *remaining, uint8 *attemptsLeft) {
+	uint8 request = LOCKOUT_STATUS_COMMAND;
+	uint8 message[LINK_MAX_PAYLOAD];
+	uint8 length = 0;
+
+	if (Link_send(&request, 1)) {
+		length = Link_receive(message, sizeof(message), REPLY_TIMEOUT);
+	}
+	if (length != LOCKOUT_STATUS_LENGTH || message[0] != LOCKOUT_STATUS_COMMAND) {
+		return FALSE;
+	}
+	*remaining = message[1] | (message[2] << 8);
+	*attemptsLeft = message[3];
+	return TRUE;
+}
+
+// Function to handle system lockout: Control_ECU owns the lockout time, polled once a second until it is over
+void waitForLockout() {
+	uint16 remaining;
+	uint8 attemptsLeft;
+
+	while (1) {
+		if (!queryLockout(&remaining, &attemptsLeft)) {
+			relink();
+			continue;
+		}
+		if (remaining == 0) {
+			break;
+		}
+		LCD_clearScreen();
+		LCD_displayString_P(PSTR("System Locked!"));
+		LCD_displayStringRowColumn_P(1, 0, PSTR("Wait "));
+		LCD_intgerToString(remaining);
+		LCD_displayString_P(PSTR(" s"));
+		Idle_delayMs(1000);
+	}
+}
+
+// Ask Control_ECU whether it holds a password, FALSE if it does not or did not answer (a new password is then asked for)
+boolean queryPasswordSet() {
+	uint8 request = PASSWORD_STATUS_COMMAND;
+	uint8 reply = 0;
+
+	if (!sendRequest(&request, 1, &reply)) {
+		relink();
+		return FALSE;
+	}
+	return (reply == 1) ? TRUE : FALSE;
+}
+
+// Ask Control_ECU for the installer settings and keep a copy, FALSE if no valid reply came
+boolean fetchConfig() {
+	uint8 request = CONFIG_GET_COMMAND;
+	uint8 message[LINK_MAX_PAYLOAD];
+	uint8 length = 0;
+	Config_Type config;
+	uint16 *fields = (uint16 *)&config;
+
+	if (Link_send(&request, 1)) {
+		length = Link_receive(message, sizeof(message), REPLY_TIMEOUT);
+	}
+	if (length != CONFIG_GET_LENGTH || message[0] != CONFIG_GET_COMMAND) {
+		return FALSE;
+	}
+	for (uint8 i = 0; i < CONFIG_FIELDS; i++) {
+		fields[i] = message[2 * i + 1] | (message[2 * i + 2] << 8);
+	}
+	return Config_replace(&config);
+}
+
+// Installer settings, one per screen: '+'/'-' next/previous, digits type a new value, Enter stores it, '=' leaves
+void editSettings() {
+	uint8 field = 0;
+	uint16 value = 0;
+	boolean typing = FALSE;
+	uint8 key;
+
+	fetchConfig();  // Start from what Control_ECU holds
+	while (1) {
 		LCD_clearScreen();
-		LCD_displayString("System Locked!");
-		while (g_tick < 60);  // Lock the system for 60 seconds (1 minute)
-		attempts = 0;  // Reset attempts count
-		Timer1Stop();  // Stop timer
+		LCD_displayString_P((const char *)pgm_read_word(&g_settingLabels[field]));
+		LCD_moveCursor(1, 0);
+		if (typing) {
+			LCD_intgerToString(value);
+			LCD_displayCharacter('_');  // Not stored yet
+		} else {
+			LCD_intgerToString(((const uint16 *)Config_get())[field]);
+		}
+
+		key = KEYPAD_getPressedKey();
+		Idle_delayMs(300);  // Delay for key debounce
+		if (key <= 9) {
+			if (!typing) {
+				value = 0;
+				typing = TRUE;
+			}
+			if (value < 1000) {
+				value = value * 10 + key;  // Up to 4 digits, every range fits
+			}
+		} else if (key == COMMAND_OPEN_DOOR || key == COMMAND_CHANGE_PASSWORD) {
+			field = (key == COMMAND_OPEN_DOOR) ? field + 1 : field + CONFIG_FIELDS - 1;
+			field %= CONFIG_FIELDS;
+			typing = FALSE;
+		} else if (key == CLEAR_KEY) {
+			typing = FALSE;
+		} else if (key == CANCEL_KEY) {
+			return;
+		} else if (key == ENTER_BUTTON && typing) {
+			LCD_clearScreen();
+			if (storeSetting(field, value)) {
+				LCD_displayString_P(PSTR("Saved"));
+			} else {
+				LCD_displayString_P(PSTR("Refused"));  // Out of range, or the unlock timed out
+			}
+			Idle_delayMs(Config_get()->messageDelay);
+			typing = FALSE;
+		}
+	}
+}
+
+// Change one setting on Control_ECU, then in the local copy, FALSE if it was refused or the link failed
+boolean storeSetting(uint8 field, uint16 value) {
+	uint8 message[5] = {CONFIG_SET_COMMAND, START_COMMUNICATION, field, (uint8)value, (uint8)(value >> 8)};
+	uint8 reply;
+
+	if (!sendRequest(message, sizeof(message), &reply)) {
+		relink();
+		return FALSE;
 	}
+	return (reply == 1) ? Config_set(field, value) : FALSE;
 }
 
-// Function to prompt the user to enter two passwords (for creation or verification)
-void enterPasswords(uint8 *passwordBuffer1, uint8 *passwordBuffer2) {
-	uint8 key1, key2;
+// Show the diagnostic pages, each until a key is pressed: profiler (PROFILE_ENABLE builds), then link health
+void showDiagnostics(uint8 key) {
+#if PROFILE_ENABLE
+	// Idle share, longest ISR run since the last look and stack headroom
+	Idle_StatsType idle;
+	Profile_IsrStatsType stats;
+	uint16 worstIsrUs = 0;
+
+	Idle_getStats(&idle);
+	for (uint8 isr = 0; isr < PROFILE_NUM_OF_ISRS; isr++) {
+		Profile_getIsrStats(isr, &stats);
+		if (stats.maxUs > worstIsrUs) {
+			worstIsrUs = stats.maxUs;
+		}
+	}
+	Profile_reset();
+
 	LCD_clearScreen();
-	LCD_displayString("Create pass :)");
-	_delay_ms(1000);
+	LCD_displayString_P(PSTR("Idle "));
+	LCD_intgerToString(idle.idlePercent);
+	LCD_displayString_P(PSTR("% W "));
+	LCD_intgerToString(idle.maxWakeLatencyUs);
+	LCD_displayStringRowColumn_P(1, 0, PSTR("ISR "));
+	LCD_intgerToString(worstIsrUs);
+	LCD_displayString_P(PSTR("us S "));
+	LCD_intgerToString(StackMonitor_getFreeBytes());  // Stack headroom left
+
+	KEYPAD_getPressedKey();
+	Idle_delayMs(500);
+	showControlProfile();
+	showCryptoCost();
+#endif
+	showLinkStatus();
+}
+
+#if PROFILE_ENABLE
+// Collect the profiler report of Control_ECU, sent in DIAG_CHUNK_LENGTH pieces, FALSE if it did not all come
+boolean queryControlProfile(uint8 *report) {
+	uint8 request = DIAG_COMMAND;
+	uint8 message[LINK_MAX_PAYLOAD];
+	uint8 length;
+	uint8 received = 0;
+
+	if (!Link_send(&request, 1)) {
+		return FALSE;
+	}
+	while (received < PROFILE_REPORT_LENGTH) {
+		length = Link_receive(message, sizeof(message), REPLY_TIMEOUT);
+		if (length == 0 || length == LINK_BREAK) {
+			return FALSE;  // Control_ECU not built with the profiler, or the link failed
+		}
+		if (length < 3 || message[0] != DIAG_COMMAND || message[1] != received || received + length - 2 > PROFILE_REPORT_LENGTH) {
+			continue;  // Not a piece of the report, or not the next one
+		}
+		memcpy(&report[received], &message[2], length - 2);
+		received += length - 2;
+	}
+	return TRUE;
+}
+
+// Same page as ours for Control_ECU: idle share and wake latency, longest ISR run and stack headroom
+void showControlProfile() {
+	uint8 report[PROFILE_REPORT_LENGTH];
+	uint8 *tail = &report[PROFILE_NUM_OF_ISRS * 8 + PROFILE_LOOP_BINS * 2];  // Idle percent, wake latency, stack
+	uint16 worstIsrUs = 0;
+	uint16 maxUs;
+
 	LCD_clearScreen();
-	LCD_displayString("Plz enter pass:");
-	LCD_moveCursor(1, 0);
+	if (!queryControlProfile(report)) {
+		LCD_displayString_P(PSTR("C no reply"));
+	} else {
+		for (uint8 isr = 0; isr < PROFILE_NUM_OF_ISRS; isr++) {
+			maxUs = report[isr * 8 + 6] | (report[isr * 8 + 7] << 8);
+			if (maxUs > worstIsrUs) {
+				worstIsrUs = maxUs;
+			}
+		}
+		LCD_displayString_P(PSTR("Idle "));
+		LCD_intgerToString(tail[0]);
+		LCD_displayString_P(PSTR("% W "));
+		LCD_intgerToString(tail[1] | (tail[2] << 8));
+		LCD_displayStringRowColumn_P(1, 0, PSTR("C ISR "));  // C marks the Control_ECU page
+		LCD_intgerToString(worstIsrUs);
+		LCD_displayString_P(PSTR("us S "));
+		LCD_intgerToString(tail[3] | (tail[4] << 8));
+	}
+
+	KEYPAD_getPressedKey();
+	Idle_delayMs(500);
+	if (!Link_isUp()) {
+		relink();
+	}
+}
+
+// Show the tag time of a full data frame (F) and of an ACK (A), and the encryption time of a passwords message against BYTE_TIME_US
+void showCryptoCost() {
+	Cmac_KeyType key;
+	uint8 secret[KEYSTORE_KEY_LENGTH] = {0};
+
+	Cmac_setKey(&key, secret);  // Same work whatever the key
+	LCD_clearScreen();
+	LCD_displayString_P(PSTR("MAC F"));
+	LCD_intgerToString(measureMac(&key, 2 + LINK_MAX_PAYLOAD + LINK_COUNTER_LENGTH));
+	LCD_displayString_P(PSTR(" A"));
+	LCD_intgerToString(measureMac(&key, 2 + LINK_COUNTER_LENGTH));
+	LCD_displayString_P(PSTR("us"));
+	LCD_displayStringRowColumn_P(1, 0, PSTR("PIN "));
+	LCD_intgerToString(measureCipher(&key.cipher, PASSWORD_MESSAGE_LENGTH));
+	LCD_displayString_P(PSTR("us B"));
+	LCD_intgerToString(BYTE_TIME_US);
 
-	// User enters the first password
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		*(passwordBuffer1 + i) = KEYPAD_getPressedKey();
-		LCD_displayCharacter('*');  // Display '*' for each entered character
-		_delay_ms(300);  // Delay for key debounce
+	KEYPAD_getPressedKey();
+	Idle_delayMs(500);
+}
+
+// Average time of one tag over length bytes, in us
+uint16 measureMac(const Cmac_KeyType *key, uint8 length) {
+	uint8 data[2 + LINK_MAX_PAYLOAD + LINK_COUNTER_LENGTH] = {0};
+	uint8 tag[CMAC_TAG_SIZE];
+	uint32 start = Systick_getMicros();
+
+	for (uint8 i = 0; i < CRYPTO_BENCH_RUNS; i++) {
+		Cmac_compute(key, data, length, tag);
 	}
+	return (uint16)((Systick_getMicros() - start) / CRYPTO_BENCH_RUNS);
+}
+
+// Average time to encrypt length bytes in counter mode, in us
+uint16 measureCipher(const Speck_KeyType *key, uint8 length) {
+	uint8 data[LINK_MAX_PAYLOAD] = {0};
+	uint8 nonce[SPECK_NONCE_SIZE] = {0};
+	uint32 start = Systick_getMicros();
 
-	// Wait for user to press the Enter key to finish entering the first password
-	while (key1 != ENTER_BUTTON) {
-		key1 = KEYPAD_getPressedKey();
-		_delay_ms(500);
+	for (uint8 i = 0; i < CRYPTO_BENCH_RUNS; i++) {
+		Speck_ctr(key, nonce, data, length);
 	}
+	return (uint16)((Systick_getMicros() - start) / CRYPTO_BENCH_RUNS);
+}
+#endif
 
-	// Prompt to re-enter the password for verification
+// Show the UART receive errors of both ECUs: H = this ECU, C = Control_ECU
+void showLinkStatus() {
+	UART_ErrorStatsType errors;
+	uint8 request = LINK_STATUS_COMMAND;
+	uint8 message[LINK_MAX_PAYLOAD];
+	uint8 length = 0;
+
+	UART_getErrorStats(&errors);
 	LCD_clearScreen();
-	LCD_displayString("Plz re-enter");
+	displayErrorCounts('H', errors.framing, errors.parity, errors.overrun, errors.overflow);
+
 	LCD_moveCursor(1, 0);
-	LCD_displayString("same pass:");
-	LCD_moveCursor(1, 10);
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		*(passwordBuffer2 + i) = KEYPAD_getPressedKey();
-		LCD_displayCharacter('*');
-		_delay_ms(300);
+	if (Link_send(&request, 1)) {
+		length = Link_receive(message, sizeof(message), REPLY_TIMEOUT);
+	}
+	if (length == LINK_STATUS_LENGTH && message[0] == LINK_STATUS_COMMAND) {
+		// Little-endian counters: framing, overrun, parity, overflow, then the link counters
+		displayErrorCounts('C', message[1] | (message[2] << 8), message[5] | (message[6] << 8),
+						   message[3] | (message[4] << 8), message[7] | (message[8] << 8));
+	} else {
+		LCD_displayString_P(PSTR("C no reply"));
 	}
 
-	// Wait for user to press Enter key again
-	while (key2 != ENTER_BUTTON) {
-		key2 = KEYPAD_getPressedKey();
-		_delay_ms(500);
+	KEYPAD_getPressedKey();
+	Idle_delayMs(500);
+	if (!Link_isUp()) {
+		relink();
 	}
 }
 
-// Function to prompt the user to enter a password for operation (unlock door or change password)
-void enterPassword(uint8 *passwordBuffer, const char *prompt) {
-	uint8 key;
+// One line of error counters: F framing, P parity, O overrun, V Rx buffer overflow
+void displayErrorCounts(uint8 tag, uint16 framing, uint16 parity, uint16 overrun, uint16 overflow) {
+	LCD_displayCharacter(tag);
+	LCD_displayString_P(PSTR(" F"));
+	LCD_intgerToString(framing);
+	LCD_displayString_P(PSTR(" P"));
+	LCD_intgerToString(parity);
+	LCD_displayString_P(PSTR(" O"));
+	LCD_intgerToString(overrun);
+	LCD_displayString_P(PSTR(" V"));
+	LCD_intgerToString(overflow);
+}
+
+#if UART_FAULT_ENABLE
+// Run BENCH_EXCHANGES open door sized exchanges through the injected faults, show success, latency and retransmissions
+void runLinkBenchmark(uint8 key) {
+	uint16 latency[BENCH_EXCHANGES];  // Completed exchanges, in 0.1 ms
+	uint8 message[3] = {LINK_BENCH_COMMAND, START_COMMUNICATION, PASSWORD_MIN_LENGTH};
+	Link_StatsType before, after;
+	uint32 start, elapsed, total = 0;
+	uint8 done = 0;
+	uint8 reply;
+
 	LCD_clearScreen();
-	LCD_displayString(prompt);  // Display the prompt for user input
-	LCD_moveCursor(1, 0);
+	LCD_displayString_P(PSTR("Benchmarking..."));
+	Link_getStats(&before);
+	for (uint8 i = 0; i < BENCH_EXCHANGES; i++) {
+		start = Systick_getMicros();
+		if (sendSecretRequest(message, sizeof(message), &reply) && reply == 1) {
+			elapsed = (Systick_getMicros() - start) / 100;
+			latency[done++] = (elapsed > 0xFFFF) ? 0xFFFF : (uint16)elapsed;
+			total += elapsed;
+		} else {
+			relink();  // Counted as a failed exchange, recovery time included in the next one
+		}
+	}
+	Link_getStats(&after);
+
+	// Insertion sort, then the p99 is read by nearest rank
+	for (uint8 i = 1; i < done; i++) {
+		uint16 value = latency[i];
+		uint8 j = i;
+		while (j > 0 && latency[j - 1] > value) {
+			latency[j] = latency[j - 1];
+			j--;
+		}
+		latency[j] = value;
+	}
+
+	LCD_clearScreen();
+	LCD_displayString_P(PSTR("OK "));
+	LCD_intgerToString((uint16)done * 100 / BENCH_EXCHANGES);
+	LCD_displayString_P(PSTR("% R "));
+	LCD_intgerToString(after.retransmits - before.retransmits);
+	LCD_displayStringRowColumn_P(1, 0, PSTR("Avg "));
+	if (done != 0) {
+		displayTenths((uint16)(total / done));
+		LCD_displayString_P(PSTR(" P99 "));
+		displayTenths(latency[((uint16)done * 99 + 99) / 100 - 1]);
+	}
+
+	KEYPAD_getPressedKey();
+	Idle_delayMs(500);
+}
+
+// Show a value in tenths as whole.tenth, e.g. 125 as 12.5 (ms)
+void displayTenths(uint16 value) {
+	LCD_intgerToString(value / 10);
+	LCD_displayCharacter('.');
+	LCD_intgerToString(value % 10);
+}
+#endif
+
+// Function to prompt the user to enter two passwords (for creation), returns their length if they match, 0 if not
+uint8 enterPasswords(uint8 *passwordBuffer1, uint8 *passwordBuffer2) {
+	uint8 length1, length2;
+	LCD_clearScreen();
+	LCD_displayString_P(PSTR("Create pass :)"));
+	Idle_delayMs(Config_get()->messageDelay);
+
+	// User enters the first password, a password is required so cancel starts it over
+	do {
+		LCD_clearScreen();
+		LCD_displayString_P(PSTR("Plz enter pass:"));
+		length1 = readPassword(passwordBuffer1, FALSE);
+	} while (length1 == ENTRY_CANCELLED);
+
+	// Prompt to re-enter the password for verification
+	do {
+		LCD_clearScreen();
+		LCD_displayString_P(PSTR("Plz re-enter:"));
+		length2 = readPassword(passwordBuffer2, FALSE);
+	} while (length2 == ENTRY_CANCELLED);
 
-	// User enters the password
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		*(passwordBuffer + i) = KEYPAD_getPressedKey();
-		LCD_displayCharacter('*');  // Display '*' for each entered character
-		_delay_ms(300);  // Delay for key debounce
+	if (length1 != length2 || memcmp(passwordBuffer1, passwordBuffer2, length1) != 0) {
+		return 0;
 	}
+	return length1;
+}
+
+// Function to prompt the user to enter a password for operation (unlock door or change password)
+// Returns its length, ENTRY_CANCELLED or ENTRY_LINK_FAILED; the digits only live on Control_ECU
+uint8 enterPassword(const char *prompt) {  // prompt is in flash (PSTR)
+	uint8 digits[PASSWORD_MAX_LENGTH];
+	uint8 length;
+	LCD_clearScreen();
+	LCD_displayString_P(prompt);  // Display the prompt for user input
+	length = readPassword(digits, TRUE);
+	memset(digits, 0, sizeof(digits));  // Do not leave the password on the stack
+	return length;
+}
+
+// Let the user type PASSWORD_MIN_LENGTH to PASSWORD_MAX_LENGTH digits on row 1, with backspace, clear and cancel
+// With stream, Control_ECU gets each digit as it is typed. Returns the length, ENTRY_CANCELLED or ENTRY_LINK_FAILED
+uint8 readPassword(uint8 *digits, boolean stream) {
+	uint8 length = 0;
+	uint8 streamed = 0;  // Digits Control_ECU absorbed, in order
+	uint8 key;
 
-	// Wait for user to press Enter key to finish entering password
-	while (key != ENTER_BUTTON) {
+	showPasswordMask(0);
+	while (1) {
 		key = KEYPAD_getPressedKey();
-		_delay_ms(500);
+		Idle_delayMs(300);  // Delay for key debounce
+		if (key <= 9 && length < PASSWORD_MAX_LENGTH) {
+			digits[length++] = key;
+		} else if (key == BACKSPACE_KEY && length > 0) {
+			length--;
+		} else if (key == CLEAR_KEY) {
+			length = 0;
+		} else if (key == CANCEL_KEY) {
+			return ENTRY_CANCELLED;
+		} else if (key == ENTER_BUTTON && length >= PASSWORD_MIN_LENGTH) {
+			return length;
+		} else {
+			continue;  // Nothing to do with this key now
+		}
+		showPasswordMask(length);
+		if (streamed > length) {
+			streamed = 0;  // Control_ECU cannot take digits back: send the rest again from position 0
+		}
+		if (stream && !streamDigits(digits, &streamed, length)) {
+			return ENTRY_LINK_FAILED;
+		}
 	}
 }
 
-// Function to send the entered password to the Control_ECU for verification
-void sendPasswordToControlECU(uint8 password[]) {
-	UART_sendByte(START_COMMUNICATION);  // Send start communication signal
-	for (uint8 i = 0; i < PASSWORD_LENGTH; i++) {
-		UART_sendByte(password[i]);  // Send each password character
+// Bring Control_ECU up to the digits typed so far, FALSE if the link failed
+boolean streamDigits(const uint8 *digits, uint8 *streamed, uint8 length) {
+	uint8 message[4] = {DIGIT_COMMAND, START_COMMUNICATION};
+	while (*streamed < length) {
+		message[2] = *streamed;  // Position 0 starts a new entry on Control_ECU
+		message[3] = digits[*streamed];
+		if (!Link_sendSecret(message, sizeof(message))) {
+			return FALSE;
+		}
+		(*streamed)++;
+	}
+	return TRUE;
+}
+
+// Display '*' for each digit on row 1, then blank the rest of the field
+void showPasswordMask(uint8 length) {
+	LCD_moveCursor(1, 0);
+	for (uint8 i = 0; i < PASSWORD_MAX_LENGTH; i++) {
+		LCD_displayCharacter((i < length) ? '*' : ' ');
+	}
+	LCD_moveCursor(1, length);
+}
+
+// Function to send a command to the Control_ECU once the password digits are streamed, for verification
+boolean sendPasswordToControlECU(uint8 command, uint8 length, uint8 *response) {
+	uint8 message[3];
+	message[0] = command;  // Open door or change password
+	message[1] = START_COMMUNICATION;  // Start of the arguments
+	message[2] = length;  // Digits streamed, so Control_ECU knows none was lost
+	return sendSecretRequest(message, sizeof(message), response);
+}
+
+// Send a message to Control_ECU and wait for its one byte reply, FALSE if the link failed
+boolean sendRequest(const uint8 *message, uint8 length, uint8 *reply) {
+	return Link_send(message, length) && receiveReply(reply);
+}
+
+// Same as sendRequest with the message encrypted, for anything carrying a password
+boolean sendSecretRequest(const uint8 *message, uint8 length, uint8 *reply) {
+	return Link_sendSecret(message, length) && receiveReply(reply);
+}
+
+// Wait for the one byte reply to a request, FALSE if none came
+boolean receiveReply(uint8 *reply) {
+	uint8 received = Link_receive(reply, 1, REPLY_TIMEOUT);
+	return (received != 0 && received != LINK_BREAK);
+}
+
+// Authenticate the link with the stored key, or collect the key from a Control_ECU that was never paired
+void setupLinkKey() {
+	uint8 key[KEYSTORE_KEY_LENGTH];
+	uint8 request = PAIR_COMMAND;
+	uint8 length = 0;
+
+	if (Keystore_readKey(key)) {
+		Link_setKey(key, TRUE, LINK_ROLE_MASTER);
+		return;
+	}
+	for (uint8 attempt = 0; attempt < PAIR_ATTEMPTS && length != 1; attempt++) {
+		length = 0;
+		if (Link_send(&request, 1)) {
+			length = Link_receive(key, sizeof(key), REPLY_TIMEOUT);
+		}
+		if (length == KEYSTORE_KEY_LENGTH) {
+			Keystore_writeKey(key);
+			Keystore_setPaired();  // Control_ECU records the pairing on our first authenticated frame
+			Link_setKey(key, TRUE, LINK_ROLE_MASTER);
+			return;
+		}
+		if (length != 1) {
+			relink();
+		}
 	}
+	// A one byte reply: the pairing button of Control_ECU was not held at its power-up, or it is paired with another HMI_ECU
+	LCD_clearScreen();
+	LCD_displayString_P(PSTR("Not paired"));
+	LCD_displayStringRowColumn_P(1, 0, PSTR("Hold pair button"));
+	while (1);
 }
 
-// Function to display a message while waiting for door lock operation to complete
-void displayWaitMessage() {
+// Find Control_ECU again and restart the link, at boot or when it stopped answering
+void relink() {
 	LCD_clearScreen();
-	LCD_displayString("Wait for people");
-	LCD_displayStringRowColumn(1, 0, "to enter");
-	_delay_ms(1000);
+	LCD_displayString_P(PSTR("Linking..."));
+	Autobaud_negotiate();
+	Link_reset();
+}
+
+// Wait for the next progress event published by Control_ECU, FALSE if none came in time
+boolean receiveDoorEvent(uint8 *event, uint8 *value) {
+	uint8 message[LINK_MAX_PAYLOAD];
+	uint8 length;
+	do {
+		length = Link_receive(message, sizeof(message), EVENT_TIMEOUT);
+		if (length == 0 || length == LINK_BREAK) {
+			return FALSE;
+		}
+	} while (length != 3 || message[0] != DOOR_EVENT_COMMAND);  // Skip anything that is not an event
+	*event = message[1];
+	*value = message[2];
+	return TRUE;
+}
+
+// Function to display the door state reported by Control_ECU until the door cycle is over
+void followDoorCycle() {
+	uint8 event, value;
+	uint8 lastEvent = 0;
+
 	while (1) {
-		uint8 pirStatus = UART_recieveByte();  // Check PIR sensor status from Control_ECU
-		if (pirStatus == 0) {
-			LCD_clearScreen();
-			LCD_displayString("Door is");
-			LCD_displayStringRowColumn(1, 0, "locking...");
-			setupTimer1();
-			g_tick = 0;
-			while (g_tick < 15);  // Wait for 15 seconds for motor operation
-			g_tick = 0;
-			Timer1Stop();
+		if (!receiveDoorEvent(&event, &value)) {
+			relink();  // Control_ECU finishes the door cycle on its own
 			break;
 		}
+		if (event == EVENT_DOOR_LOCKED) {
+			break;
+		}
+		if (event != lastEvent) {
+			// Redraw the whole screen only when the door changes state
+			lastEvent = event;
+			LCD_clearScreen();
+			if (event == EVENT_DOOR_OPENING) {
+				LCD_displayString_P(PSTR("Door is"));
+				LCD_displayStringRowColumn_P(1, 0, PSTR("Unlocking..."));
+			} else if (event == EVENT_DOOR_HOLDING) {
+				LCD_displayString_P(PSTR("Wait for people"));
+				LCD_displayStringRowColumn_P(1, 0, PSTR("to enter"));
+			} else if (event == EVENT_DOOR_CLOSING) {
+				LCD_displayString_P(PSTR("Door is"));
+				LCD_displayStringRowColumn_P(1, 0, PSTR("locking..."));
+			}
+		}
+		if (event == EVENT_DOOR_OPENING || event == EVENT_DOOR_CLOSING) {
+			LCD_moveCursor(1, 12);
+			LCD_intgerToString(value);  // Travel progress in percent
+			LCD_displayCharacter('%');
+		}
 	}
 }
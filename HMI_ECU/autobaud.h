@@ -0,0 +1,60 @@
+ /******************************************************************************
+ *
+ * Module: Autobaud
+ *
+ * File Name: autobaud.h
+ *
+ * Description: Header file for the link rate negotiation. Both ECUs start
+ *              at AUTOBAUD_BASE_RATE; HMI_ECU (master) then proposes the
+ *              candidate rates from the fastest down, both switch, and the
+ *              first rate whose loopback test passes is confirmed. A failed
+ *              step falls back to the base rate on both sides by timeout.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef AUTOBAUD_H_
+#define AUTOBAUD_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define AUTOBAUD_BASE_RATE      9600UL
+
+/* Protocol bytes, sent at whichever rate both sides are on */
+#define AUTOBAUD_HELLO          0x31  /* Master looking for the slave, echoed */
+#define AUTOBAUD_HELLO_REPEAT   2     /* HELLOs sent in a row, a single 0x31 may be a stray frame byte */
+#define AUTOBAUD_PROPOSE        0x32  /* Followed by the candidate index, echoed if accepted */
+#define AUTOBAUD_CONFIRM        0x33  /* Ends the negotiation at the current rate, echoed */
+
+#define AUTOBAUD_REPLY_TIMEOUT  100   /* ms to wait for an echo */
+#define AUTOBAUD_SETTLE_TIME    10    /* ms for the slave to switch after its echo */
+#define AUTOBAUD_TEST_WINDOW    500   /* ms the slave stays on a candidate without CONFIRM */
+#define AUTOBAUD_SERVE_TIMEOUT  2000  /* ms of silence after which the slave gives up, above any gap the master leaves */
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Master side: find the slave at the base rate (or at a candidate rate it
+ * was left at), then step down the candidate rates until one passes the
+ * loopback test. Returns the rate in use.
+ */
+uint32 Autobaud_negotiate(void);
+
+/*
+ * Description :
+ * Slave side: answer the master until it confirms a rate, starting with a
+ * protocol byte already received (AUTOBAUD_HELLO), or 0 to wait for one.
+ * If the master goes silent for AUTOBAUD_SERVE_TIMEOUT, the rate in use
+ * before is restored. Returns the rate in use.
+ */
+uint32 Autobaud_serve(uint8 first);
+
+#endif /* AUTOBAUD_H_ */
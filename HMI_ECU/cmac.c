@@ -0,0 +1,125 @@
+ /******************************************************************************
+ *
+ * Module: CMAC
+ *
+ * File Name: cmac.c
+ *
+ * Description: Source file for CMAC over Speck64/128
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "cmac.h"
+
+#define CMAC_RB 0x1B  /* x^64 + x^4 + x^3 + x + 1 */
+
+/* Multiply by x in GF(2^64): shift the block left one bit, big-endian */
+static void Cmac_double(const uint8 *in, uint8 *out)
+{
+	uint8 carry = in[0] & 0x80;
+	uint8 i;
+
+	for (i = 0; i < SPECK_BLOCK_SIZE - 1; i++)
+	{
+		out[i] = (uint8)((in[i] << 1) | (in[i + 1] >> 7));
+	}
+	out[SPECK_BLOCK_SIZE - 1] = (uint8)(in[SPECK_BLOCK_SIZE - 1] << 1);
+	if (carry)
+	{
+		out[SPECK_BLOCK_SIZE - 1] ^= CMAC_RB;
+	}
+}
+
+/* Fold a full block into the chain */
+static void Cmac_absorb(const Cmac_KeyType *key, Cmac_StateType *state, const uint8 *block)
+{
+	uint8 i;
+
+	for (i = 0; i < SPECK_BLOCK_SIZE; i++)
+	{
+		state->chain[i] ^= block[i];
+	}
+	Speck_encrypt(&key->cipher, state->chain);
+}
+
+void Cmac_setKey(Cmac_KeyType *key, const uint8 *secret)
+{
+	uint8 l[SPECK_BLOCK_SIZE] = {0};
+
+	Speck_setKey(&key->cipher, secret);
+	Speck_encrypt(&key->cipher, l);
+	Cmac_double(l, key->k1);
+	Cmac_double(key->k1, key->k2);
+}
+
+void Cmac_start(Cmac_StateType *state)
+{
+	uint8 i;
+
+	for (i = 0; i < SPECK_BLOCK_SIZE; i++)
+	{
+		state->chain[i] = 0;
+	}
+	state->used = 0;
+}
+
+void Cmac_update(const Cmac_KeyType *key, Cmac_StateType *state, const uint8 *data, uint8 length)
+{
+	while (length--)
+	{
+		/* A full buffer is only processed once more data shows it is not the last block */
+		if (state->used == SPECK_BLOCK_SIZE)
+		{
+			Cmac_absorb(key, state, state->buffer);
+			state->used = 0;
+		}
+		state->buffer[state->used++] = *data++;
+	}
+}
+
+void Cmac_finish(const Cmac_KeyType *key, Cmac_StateType *state, uint8 *tag)
+{
+	const uint8 *subkey = key->k1;
+	uint8 i;
+
+	if (state->used < SPECK_BLOCK_SIZE)
+	{
+		/* Incomplete (or empty) last block: pad with 10..0 */
+		state->buffer[state->used] = 0x80;
+		for (i = state->used + 1; i < SPECK_BLOCK_SIZE; i++)
+		{
+			state->buffer[i] = 0;
+		}
+		subkey = key->k2;
+	}
+	for (i = 0; i < SPECK_BLOCK_SIZE; i++)
+	{
+		state->buffer[i] ^= subkey[i];
+	}
+	Cmac_absorb(key, state, state->buffer);
+	for (i = 0; i < CMAC_TAG_SIZE; i++)
+	{
+		tag[i] = state->chain[i];
+	}
+}
+
+void Cmac_compute(const Cmac_KeyType *key, const uint8 *data, uint8 length, uint8 *tag)
+{
+	Cmac_StateType state;
+
+	Cmac_start(&state);
+	Cmac_update(key, &state, data, length);
+	Cmac_finish(key, &state, tag);
+}
+
+boolean Cmac_equal(const uint8 *a, const uint8 *b, uint8 length)
+{
+	uint8 difference = 0;
+
+	while (length--)
+	{
+		difference |= *a++ ^ *b++;
+	}
+	return (difference == 0) ? TRUE : FALSE;
+}
@@ -0,0 +1,82 @@
+ /******************************************************************************
+ *
+ * Module: Config
+ *
+ * File Name: config.h
+ *
+ * Description: Header file for the installer settings. The interface is the
+ *              same on both ECUs; the record is versioned and CRC checked,
+ *              loaded once at boot and read from RAM afterwards. Control_ECU
+ *              owns the settings in the external EEPROM, HMI_ECU keeps a
+ *              copy in the internal one, fetched over the link.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Bumped when the layout changes, an older record is replaced by the defaults */
+#define CONFIG_VERSION          1
+
+/* Field numbers, in Config_Type order */
+#define CONFIG_DOOR_TRAVEL_TIME 0
+#define CONFIG_DOOR_RAMP_TIME   1
+#define CONFIG_STALL_RETRIES    2
+#define CONFIG_ATTEMPTS_LIMIT   3
+#define CONFIG_LOCKOUT_TIME     4
+#define CONFIG_SPLASH_DELAY     5
+#define CONFIG_MESSAGE_DELAY    6
+#define CONFIG_FIELDS           7
+
+/* Settings, every field a uint16 so one set command fits them all */
+typedef struct
+{
+    uint16 doorTravelTime;  // Seconds for a full open or close travel, ramps included
+    uint16 doorRampTime;    // Soft-start and soft-stop time in ms
+    uint16 stallRetries;    // Reopen and close again this often when closing is blocked
+    uint16 attemptsLimit;   // Failures in a row that start a lockout
+    uint16 lockoutTime;     // Seconds of the first lockout in a row
+    uint16 splashDelay;     // ms each boot screen of HMI_ECU is shown
+    uint16 messageDelay;    // ms a result message of HMI_ECU is shown
+} Config_Type;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Load the stored settings, or the defaults if the record is blank, of
+ * another version or fails its CRC. Call it once at boot.
+ */
+void Config_load(void);
+
+/*
+ * Description :
+ * The settings in RAM.
+ */
+const Config_Type *Config_get(void);
+
+/*
+ * Description :
+ * Change one field and store the record. Returns FALSE, changing nothing,
+ * for an unknown field or a value out of its range.
+ */
+boolean Config_set(uint8 field, uint16 value);
+
+/*
+ * Description :
+ * Take all the settings at once and store them if they changed. Returns
+ * FALSE, changing nothing, if any field is out of its range.
+ */
+boolean Config_replace(const Config_Type *config);
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,66 @@
+ /******************************************************************************
+ *
+ * Module: Idle
+ *
+ * File Name: idle.h
+ *
+ * Description: Header file for the idle hook. Waiting loops call it to put
+ *              the CPU in Idle sleep until the next interrupt instead of
+ *              spinning. The 1 ms system tick is always a wake source, so
+ *              a polled condition is seen at most one tick late.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef IDLE_H_
+#define IDLE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+/* Idle statistics since the previous Idle_getStats() call */
+typedef struct
+{
+    uint8 idlePercent;         // Share of wall time spent asleep
+    uint16 maxWakeLatencyUs;   // Worst tick-to-main-loop latency after a tick wake
+    uint32 sleeps;             // Number of times the CPU went to sleep
+} Idle_StatsType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Sleep in Idle mode until the next interrupt (at most 1 ms with the system
+ * tick running). Call it from waiting loops once there is nothing to do.
+ */
+void Idle_sleep(void);
+
+/*
+ * Description :
+ * Same as Idle_sleep(), unless isPending returns TRUE. The check and the
+ * sleep are atomic: an interrupt making the condition true after the check
+ * still ends the sleep at once instead of on the next tick. isPending runs
+ * with interrupts disabled.
+ */
+void Idle_sleepUnless(boolean (*isPending)(void));
+
+/*
+ * Description :
+ * Wait for the given number of milliseconds, sleeping between ticks.
+ * Replaces _delay_ms() once the system tick is running.
+ */
+void Idle_delayMs(uint16 ms);
+
+/*
+ * Description :
+ * Copy the statistics of the current window and start a new one.
+ */
+void Idle_getStats(Idle_StatsType *stats);
+
+#endif /* IDLE_H_ */
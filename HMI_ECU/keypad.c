@@ -11,7 +11,8 @@
  *******************************************************************************/
 #include "keypad.h"
 #include "gpio.h"
-#include <util/delay.h>
+#include "idle.h"
+#include <avr/pgmspace.h>
 
 /*******************************************************************************
  *                      Functions Prototypes(Private)                          *
@@ -87,7 +88,7 @@ uint8 KEYPAD_getPressedKey(void)
 				}
 			}
 			GPIO_setupPinDirection(KEYPAD_ROW_PORT_ID,KEYPAD_FIRST_ROW_PIN_ID+row,PIN_INPUT);
-			_delay_ms(5); /* Add small delay to fix CPU load issue in proteus */
+			Idle_delayMs(5); /* Sleep between rows instead of scanning at full CPU load */
 		}
 	}	
 }
@@ -101,19 +102,14 @@ uint8 KEYPAD_getPressedKey(void)
  */
 static uint8 KEYPAD_4x3_adjustKeyNumber(uint8 button_number)
 {
-	uint8 keypad_button = 0;
-	switch(button_number)
-	{
-		case 10: keypad_button = '*'; // ASCII Code of *
-				 break;
-		case 11: keypad_button = 0;
-				 break;		
-		case 12: keypad_button = '#'; // ASCII Code of #
-				 break;
-		default: keypad_button = button_number;
-				break;
-	}
-	return keypad_button;
+	/* Functional value of switch 1 to 12, kept in flash */
+	static const uint8 keypad_map[12] PROGMEM = {
+		1,   2,   3,
+		4,   5,   6,
+		7,   8,   9,
+		'*', 0,   '#'  /* ASCII Codes of '*' and '#' */
+	};
+	return pgm_read_byte(&keypad_map[button_number - 1]);
 } 
 
 #elif (KEYPAD_NUM_COLS == 4)
@@ -124,45 +120,14 @@ static uint8 KEYPAD_4x3_adjustKeyNumber(uint8 button_number)
  */
 static uint8 KEYPAD_4x4_adjustKeyNumber(uint8 button_number)
 {
-	uint8 keypad_button = 0;
-	switch(button_number)
-	{
-		case 1: keypad_button = 7;
-				break;
-		case 2: keypad_button = 8;
-				break;
-		case 3: keypad_button = 9;
-				break;
-		case 4: keypad_button = '%'; // ASCII Code of %
-				break;
-		case 5: keypad_button = 4;
-				break;
-		case 6: keypad_button = 5;
-				break;
-		case 7: keypad_button = 6;
-				break;
-		case 8: keypad_button = '*'; /* ASCII Code of '*' */
-				break;		
-		case 9: keypad_button = 1;
-				break;
-		case 10: keypad_button = 2;
-				break;
-		case 11: keypad_button = 3;
-				break;
-		case 12: keypad_button = '-'; /* ASCII Code of '-' */
-				break;
-		case 13: keypad_button = 13;  /* ASCII of Enter */
-				break;			
-		case 14: keypad_button = 0;
-				break;
-		case 15: keypad_button = '='; /* ASCII Code of '=' */
-				break;
-		case 16: keypad_button = '+'; /* ASCII Code of '+' */
-				break;
-		default: keypad_button = button_number;
-				break;
-	}
-	return keypad_button;
+	/* Functional value of switch 1 to 16, kept in flash */
+	static const uint8 keypad_map[16] PROGMEM = {
+		7,   8,   9,   '%',  /* ASCII Code of % */
+		4,   5,   6,   '*',  /* ASCII Code of '*' */
+		1,   2,   3,   '-',  /* ASCII Code of '-' */
+		13,  0,   '=', '+'   /* ASCII of Enter, '=' and '+' */
+	};
+	return pgm_read_byte(&keypad_map[button_number - 1]);
 } 
 
 #endif
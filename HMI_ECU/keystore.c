@@ -0,0 +1,64 @@
+ /******************************************************************************
+ *
+ * Module: Keystore
+ *
+ * File Name: keystore.c
+ *
+ * Description: Source file for the link key storage of HMI_ECU, in the
+ *              internal EEPROM
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "keystore.h"
+#include <avr/eeprom.h>
+
+/* Record layout in the internal EEPROM */
+#define KEYSTORE_KEY_ADDRESS        ((uint8 *)0x0000)
+#define KEYSTORE_STATE_ADDRESS      ((uint8 *)0x0010)  /* KEYSTORE_STATE_* */
+#define KEYSTORE_SESSION_ADDRESS    ((uint16 *)0x0011) /* Two uint16, tx then rx */
+
+#define KEYSTORE_STATE_BLANK        0xFF
+#define KEYSTORE_STATE_PENDING      0x5A    /* Key stored, peer not heard from yet */
+#define KEYSTORE_STATE_PAIRED       0xA5
+
+boolean Keystore_readKey(uint8 *key)
+{
+	uint8 state = eeprom_read_byte(KEYSTORE_STATE_ADDRESS);
+
+	if (state != KEYSTORE_STATE_PENDING && state != KEYSTORE_STATE_PAIRED)
+	{
+		return FALSE;
+	}
+	eeprom_read_block(key, KEYSTORE_KEY_ADDRESS, KEYSTORE_KEY_LENGTH);
+	return TRUE;
+}
+
+void Keystore_writeKey(const uint8 *key)
+{
+	eeprom_write_block(key, KEYSTORE_KEY_ADDRESS, KEYSTORE_KEY_LENGTH);
+	eeprom_write_byte(KEYSTORE_STATE_ADDRESS, KEYSTORE_STATE_PENDING);
+}
+
+boolean Keystore_isPaired(void)
+{
+	return (eeprom_read_byte(KEYSTORE_STATE_ADDRESS) == KEYSTORE_STATE_PAIRED) ? TRUE : FALSE;
+}
+
+void Keystore_setPaired(void)
+{
+	eeprom_write_byte(KEYSTORE_STATE_ADDRESS, KEYSTORE_STATE_PAIRED);
+}
+
+uint16 Keystore_readSession(uint8 direction)
+{
+	uint16 session = eeprom_read_word(KEYSTORE_SESSION_ADDRESS + direction);
+
+	return (session == 0xFFFF) ? 0 : session;
+}
+
+void Keystore_writeSession(uint8 direction, uint16 session)
+{
+	eeprom_write_word(KEYSTORE_SESSION_ADDRESS + direction, session);
+}
@@ -0,0 +1,71 @@
+ /******************************************************************************
+ *
+ * Module: Keystore
+ *
+ * File Name: keystore.h
+ *
+ * Description: Header file for the link key storage. The interface is the
+ *              same on both ECUs; Control_ECU keeps the record in the
+ *              external EEPROM, HMI_ECU in the internal one.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef KEYSTORE_H_
+#define KEYSTORE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define KEYSTORE_KEY_LENGTH     16
+
+/* Session numbers, one per direction of the link */
+#define KEYSTORE_TX_SESSION     0
+#define KEYSTORE_RX_SESSION     1
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Copy the link key. Returns FALSE if none was provisioned.
+ */
+boolean Keystore_readKey(uint8 *key);
+
+/*
+ * Description :
+ * Store a new link key, not confirmed by the peer yet.
+ */
+void Keystore_writeKey(const uint8 *key);
+
+/*
+ * Description :
+ * TRUE once the peer proved it holds the stored key.
+ */
+boolean Keystore_isPaired(void);
+
+/*
+ * Description :
+ * Record that the peer proved it holds the stored key.
+ */
+void Keystore_setPaired(void);
+
+/*
+ * Description :
+ * Last session number used in one direction, 0 on blank memory. Session
+ * numbers only grow, whatever the key, so old frames never become fresh.
+ */
+uint16 Keystore_readSession(uint8 direction);
+
+/*
+ * Description :
+ * Record the session number now used in one direction.
+ */
+void Keystore_writeSession(uint8 direction, uint16 session);
+
+#endif /* KEYSTORE_H_ */
@@ -14,6 +14,7 @@
 #include "common_macros.h" /* For GET_BIT Macro */
 #include "lcd.h"
 #include "gpio.h"
+#include <avr/pgmspace.h> /* For reading strings from flash */
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -161,6 +162,20 @@ void LCD_displayString(const char *Str)
 	*********************************************************/
 }
 
+/*
+ * Description :
+ * Display the required string stored in flash (PROGMEM / PSTR) on the screen
+ */
+void LCD_displayString_P(const char *Str)
+{
+	char c;
+	while((c = pgm_read_byte(Str)) != '\0')
+	{
+		LCD_displayCharacter(c);
+		Str++;
+	}
+}
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
@@ -199,6 +214,16 @@ void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str)
 	LCD_displayString(Str); /* display the string */
 }
 
+/*
+ * Description :
+ * Display the required flash string in a specified row and column index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str)
+{
+	LCD_moveCursor(row,col); /* go to to the required LCD position */
+	LCD_displayString_P(Str); /* display the string */
+}
+
 /*
  * Description :
  * Display the required decimal value on the screen
@@ -87,6 +87,12 @@ void LCD_displayCharacter(uint8 data);
  */
 void LCD_displayString(const char *Str);
 
+/*
+ * Description :
+ * Display the required string stored in flash (PROGMEM / PSTR) on the screen
+ */
+void LCD_displayString_P(const char *Str);
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
@@ -99,6 +105,12 @@ void LCD_moveCursor(uint8 row,uint8 col);
  */
 void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str);
 
+/*
+ * Description :
+ * Display the required flash string in a specified row and column index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str);
+
 /*
  * Description :
  * Display the required decimal value on the screen
@@ -0,0 +1,458 @@
+ /******************************************************************************
+ *
+ * Module: Link
+ *
+ * File Name: link.c
+ *
+ * Description: Source file for the reliable inter-ECU link
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "link.h"
+#include "uart.h"
+#include "systick.h"
+#include "autobaud.h"
+#include "cmac.h"
+#include "speck.h"
+#include "keystore.h"
+#include <util/crc16.h>
+
+typedef struct
+{
+	uint8 control;
+	uint8 length;
+	uint8 payload[LINK_MAX_PAYLOAD];
+	uint8 auth[LINK_AUTH_LENGTH];
+} Link_FrameType;
+
+/* Link_readFrame results */
+#define LINK_READ_TIMEOUT   0
+#define LINK_READ_FRAME     1
+#define LINK_READ_BREAK     2
+
+static boolean g_linkUp = TRUE;
+static uint8 g_txSeq = 0;
+static uint8 g_lastRxSeq = 0;
+static boolean g_rxValid = FALSE;    // No message received since the last reset: accept any sequence
+static boolean g_breakPending = FALSE;
+
+/* A new message that arrived while we were waiting for an ACK */
+static uint8 g_pending[LINK_MAX_PAYLOAD];
+static uint8 g_pendingLength = 0;
+
+static Link_StatsType g_stats;
+
+static boolean g_keyed = FALSE;
+static boolean g_learning = FALSE;  // Keyed, but the peer has not proved it holds the key yet
+static Cmac_KeyType g_macKey;
+static Speck_KeyType g_cipherKey;   // Secret frames, derived from the link key
+static uint8 g_role = LINK_ROLE_MASTER;
+static uint32 g_txCounter = 0;
+static uint32 g_rxCounter = 0;      // Last counter accepted
+static uint16 g_rxSession = 0;      // Upper half of g_rxCounter, as stored in the keystore
+
+/* Tag of a frame: sender's role, control, length, payload and counter; the role keeps a frame from being reflected back to its sender */
+static void Link_tag(uint8 direction, uint8 control, uint8 length, const uint8 *payload, const uint8 *counter, uint8 *tag)
+{
+	Cmac_StateType state;
+	uint8 header[3] = {direction, control, length};
+
+	Cmac_start(&state);
+	Cmac_update(&g_macKey, &state, header, sizeof(header));
+	Cmac_update(&g_macKey, &state, payload, length);
+	Cmac_update(&g_macKey, &state, counter, LINK_COUNTER_LENGTH);
+	Cmac_finish(&g_macKey, &state, tag);
+}
+
+/* Encrypt or decrypt a secret payload: counter and direction (the sender's role) make the nonce */
+static void Link_crypt(const uint8 *counter, uint8 direction, uint8 *data, uint8 length)
+{
+	uint8 nonce[SPECK_NONCE_SIZE] = {0};
+	uint8 i;
+
+	for (i = 0; i < LINK_COUNTER_LENGTH; i++)
+	{
+		nonce[i] = counter[i];
+	}
+	nonce[LINK_COUNTER_LENGTH] = direction;
+	Speck_ctr(&g_cipherKey, nonce, data, length);
+}
+
+/* Counter, encryption if secret, and tag of an outgoing frame; payload is changed in place */
+static void Link_sign(uint8 control, uint8 *payload, uint8 length, uint8 *auth)
+{
+	uint8 tag[CMAC_TAG_SIZE];
+	uint8 i;
+
+	g_txCounter++;
+	if ((uint16)g_txCounter == 0)
+	{
+		Keystore_writeSession(KEYSTORE_TX_SESSION, (uint16)(g_txCounter >> 16));  /* Next session */
+	}
+	for (i = 0; i < LINK_COUNTER_LENGTH; i++)
+	{
+		auth[i] = (uint8)(g_txCounter >> (8 * i));
+	}
+	if (control & LINK_FLAG_SECRET)
+	{
+		Link_crypt(auth, g_role, payload, length);
+	}
+	Link_tag(g_role, control, length, payload, auth, tag);
+	for (i = 0; i < LINK_TAG_LENGTH; i++)
+	{
+		auth[LINK_COUNTER_LENGTH + i] = tag[i];
+	}
+}
+
+/* Check the tag and freshness of a received frame, then decrypt it if secret */
+static boolean Link_authenticate(Link_FrameType *frame)
+{
+	uint8 tag[CMAC_TAG_SIZE];
+	uint32 counter = 0;
+	uint8 i;
+
+	if (!(frame->control & LINK_FLAG_AUTH))
+	{
+		return ((!g_keyed || g_learning) && !(frame->control & LINK_FLAG_SECRET)) ? TRUE : FALSE;
+	}
+	if (!g_keyed)
+	{
+		return FALSE;
+	}
+	Link_tag(g_role ^ 1, frame->control, frame->length, frame->payload, frame->auth, tag);
+	if (!Cmac_equal(tag, &frame->auth[LINK_COUNTER_LENGTH], LINK_TAG_LENGTH))
+	{
+		return FALSE;
+	}
+	for (i = LINK_COUNTER_LENGTH; i > 0; i--)
+	{
+		counter = (counter << 8) | frame->auth[i - 1];
+	}
+	if (counter <= g_rxCounter)
+	{
+		return FALSE;  /* Replayed */
+	}
+	g_rxCounter = counter;
+	if ((uint16)(counter >> 16) != g_rxSession)
+	{
+		g_rxSession = (uint16)(counter >> 16);
+		Keystore_writeSession(KEYSTORE_RX_SESSION, g_rxSession);
+	}
+	if (g_learning)
+	{
+		g_learning = FALSE;
+		Keystore_setPaired();
+	}
+	if (frame->control & LINK_FLAG_SECRET)
+	{
+		Link_crypt(frame->auth, g_role ^ 1, frame->payload, frame->length);
+	}
+	return TRUE;
+}
+
+static void Link_writeFrame(uint8 control, const uint8 *payload, uint8 length)
+{
+	uint8 body[LINK_MAX_PAYLOAD];  /* Payload as sent: a retransmission is encrypted again under its new counter */
+	uint8 auth[LINK_AUTH_LENGTH];
+	uint16 crc = 0xFFFF;
+	uint8 i;
+
+	if (g_keyed && !g_learning)
+	{
+		control |= LINK_FLAG_AUTH;
+		for (i = 0; i < length; i++)
+		{
+			body[i] = payload[i];
+		}
+		payload = body;
+		Link_sign(control, body, length, auth);  /* Before the first byte goes out */
+	}
+	crc = _crc_ccitt_update(crc, control);
+	crc = _crc_ccitt_update(crc, length);
+	UART_sendByte(LINK_SOF);
+	UART_sendByte(control);
+	UART_sendByte(length);
+	for (i = 0; i < length; i++)
+	{
+		crc = _crc_ccitt_update(crc, payload[i]);
+		UART_sendByte(payload[i]);
+	}
+	if (control & LINK_FLAG_AUTH)
+	{
+		for (i = 0; i < LINK_AUTH_LENGTH; i++)
+		{
+			crc = _crc_ccitt_update(crc, auth[i]);
+			UART_sendByte(auth[i]);
+		}
+	}
+	UART_sendByte((uint8)(crc >> 8));
+	UART_sendByte((uint8)crc);
+}
+
+/* Read the next count bytes of a frame into the CRC, FALSE if it was cut short */
+static boolean Link_readBytes(uint8 *data, uint8 count, uint16 *crc)
+{
+	uint8 i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (!UART_receiveByteTimeout(&data[i], LINK_BYTE_TIMEOUT))
+		{
+			return FALSE;
+		}
+		*crc = _crc_ccitt_update(*crc, data[i]);
+	}
+	return TRUE;
+}
+
+/* Read the next valid frame, skipping noise and damaged frames */
+static uint8 Link_readFrame(Link_FrameType *frame, uint16 timeout_ms)
+{
+	uint32 start = Systick_getMillis();
+	uint32 elapsed;
+	uint16 crc;
+	uint8 high, low;
+	uint8 data;
+	uint8 hellos;
+
+	while (1)
+	{
+		/* Hunt for the start of a frame in the time left */
+		hellos = 0;
+		do
+		{
+			elapsed = Systick_elapsedSince(start);
+			if (elapsed >= timeout_ms || !UART_receiveByteTimeout(&data, (uint16)(timeout_ms - elapsed)))
+			{
+				return LINK_READ_TIMEOUT;
+			}
+			/* Only HELLOs in a row start a negotiation, a lone 0x31 is left over from a damaged frame */
+			hellos = (data == AUTOBAUD_HELLO) ? hellos + 1 : 0;
+			if (hellos == AUTOBAUD_HELLO_REPEAT)
+			{
+				return LINK_READ_BREAK;
+			}
+		} while (data != LINK_SOF);
+
+		/* The rest of the frame is sent back to back */
+		if (!UART_receiveByteTimeout(&frame->control, LINK_BYTE_TIMEOUT) ||
+			!UART_receiveByteTimeout(&frame->length, LINK_BYTE_TIMEOUT) || frame->length > LINK_MAX_PAYLOAD)
+		{
+			g_stats.badFrames++;
+			continue;
+		}
+		crc = _crc_ccitt_update(0xFFFF, frame->control);
+		crc = _crc_ccitt_update(crc, frame->length);
+		if (!Link_readBytes(frame->payload, frame->length, &crc) ||
+			((frame->control & LINK_FLAG_AUTH) && !Link_readBytes(frame->auth, LINK_AUTH_LENGTH, &crc)) ||
+			!UART_receiveByteTimeout(&high, LINK_BYTE_TIMEOUT) ||
+			!UART_receiveByteTimeout(&low, LINK_BYTE_TIMEOUT) || crc != (((uint16)high << 8) | low))
+		{
+			g_stats.badFrames++;
+			continue;
+		}
+		if (!Link_authenticate(frame))
+		{
+			g_stats.authFailures++;
+			continue;
+		}
+		return LINK_READ_FRAME;
+	}
+}
+
+/* Acknowledge a data frame, TRUE if it is a new message */
+static boolean Link_acceptData(const Link_FrameType *frame)
+{
+	uint8 seq = frame->control & LINK_SEQ_MASK;
+
+	/* Always ACK: a duplicate means our last ACK was lost */
+	Link_writeFrame(LINK_TYPE_ACK | seq, NULL_PTR, 0);
+	if (g_rxValid && seq == g_lastRxSeq)
+	{
+		g_stats.duplicates++;
+		return FALSE;
+	}
+	g_rxValid = TRUE;
+	g_lastRxSeq = seq;
+	return TRUE;
+}
+
+void Link_reset(void)
+{
+	uint16 session = Keystore_readSession(KEYSTORE_TX_SESSION) + 1;
+
+	/* A new session makes every counter sent before this one stale */
+	Keystore_writeSession(KEYSTORE_TX_SESSION, session);
+	g_txCounter = (uint32)session << 16;
+	g_txSeq = 0;
+	g_rxValid = FALSE;
+	g_pendingLength = 0;
+	g_breakPending = FALSE;
+	g_linkUp = TRUE;
+}
+
+void Link_setKey(const uint8 *key, boolean paired, uint8 role)
+{
+	uint8 cipherKey[SPECK_KEY_SIZE];
+	uint8 label;
+
+	Cmac_setKey(&g_macKey, key);
+	/* Encryption key: CMAC of labels 1 and 2, never the same key for two jobs */
+	for (label = 1; label <= SPECK_KEY_SIZE / CMAC_TAG_SIZE; label++)
+	{
+		Cmac_compute(&g_macKey, &label, 1, &cipherKey[(label - 1) * CMAC_TAG_SIZE]);
+	}
+	Speck_setKey(&g_cipherKey, cipherKey);
+	g_role = role;
+	/* Only sessions the peer starts from now on are fresh */
+	g_rxSession = Keystore_readSession(KEYSTORE_RX_SESSION);
+	g_rxCounter = ((uint32)g_rxSession << 16) | 0xFFFF;
+	g_keyed = TRUE;
+	g_learning = !paired;
+}
+
+/* Link_send and Link_sendSecret, flags is 0 or LINK_FLAG_SECRET */
+static boolean Link_transmit(const uint8 *payload, uint8 length, uint8 flags)
+{
+	Link_FrameType frame;
+	uint32 start;
+	uint32 elapsed;
+	uint8 result;
+	uint8 attempt;
+	uint8 i;
+
+	if (!g_linkUp || length == 0 || length > LINK_MAX_PAYLOAD)
+	{
+		return FALSE;
+	}
+	g_txSeq = (g_txSeq + 1) & LINK_SEQ_MASK;
+
+	for (attempt = 0; attempt <= LINK_MAX_RETRIES; attempt++)
+	{
+		if (attempt != 0)
+		{
+			g_stats.retransmits++;
+		}
+		Link_writeFrame(LINK_TYPE_DATA | flags | g_txSeq, payload, length);
+
+		start = Systick_getMillis();
+		while ((elapsed = Systick_elapsedSince(start)) < LINK_ACK_TIMEOUT)
+		{
+			result = Link_readFrame(&frame, (uint16)(LINK_ACK_TIMEOUT - elapsed));
+			if (result == LINK_READ_BREAK)
+			{
+				/* The peer gave up on us and renegotiates: stop here and report it */
+				g_breakPending = TRUE;
+				g_linkUp = FALSE;
+				g_stats.failures++;
+				return FALSE;
+			}
+			if (result == LINK_READ_TIMEOUT)
+			{
+				break;
+			}
+			if ((frame.control & LINK_TYPE_MASK) == LINK_TYPE_ACK)
+			{
+				if ((frame.control & LINK_SEQ_MASK) == g_txSeq)
+				{
+					g_stats.sent++;
+					return TRUE;
+				}
+			}
+			else if (g_pendingLength == 0 && Link_acceptData(&frame))
+			{
+				/* Both sides sent at once: keep the peer's message for Link_receive */
+				for (i = 0; i < frame.length; i++)
+				{
+					g_pending[i] = frame.payload[i];
+				}
+				g_pendingLength = frame.length;
+			}
+		}
+	}
+
+	g_linkUp = FALSE;
+	g_stats.failures++;
+	return FALSE;
+}
+
+boolean Link_send(const uint8 *payload, uint8 length)
+{
+	return Link_transmit(payload, length, 0);
+}
+
+boolean Link_sendSecret(const uint8 *payload, uint8 length)
+{
+	if (!g_keyed || g_learning)
+	{
+		return FALSE;
+	}
+	return Link_transmit(payload, length, LINK_FLAG_SECRET);
+}
+
+uint8 Link_receive(uint8 *payload, uint8 max_length, uint16 timeout_ms)
+{
+	Link_FrameType frame;
+	uint32 start = Systick_getMillis();
+	uint32 elapsed;
+	uint8 result;
+	uint8 i;
+
+	if (g_breakPending)
+	{
+		g_breakPending = FALSE;
+		return LINK_BREAK;
+	}
+	if (g_pendingLength != 0)
+	{
+		frame.length = g_pendingLength;
+		for (i = 0; i < frame.length; i++)
+		{
+			frame.payload[i] = g_pending[i];
+		}
+		g_pendingLength = 0;
+	}
+	else
+	{
+		do
+		{
+			elapsed = Systick_elapsedSince(start);
+			if (elapsed >= timeout_ms)
+			{
+				return 0;
+			}
+			result = Link_readFrame(&frame, (uint16)(timeout_ms - elapsed));
+			if (result == LINK_READ_BREAK)
+			{
+				return LINK_BREAK;
+			}
+			if (result == LINK_READ_TIMEOUT)
+			{
+				return 0;
+			}
+			/* Stale ACKs and empty frames are not messages */
+		} while ((frame.control & LINK_TYPE_MASK) != LINK_TYPE_DATA || frame.length == 0 || !Link_acceptData(&frame));
+	}
+
+	if (frame.length > max_length)
+	{
+		frame.length = max_length;
+	}
+	for (i = 0; i < frame.length; i++)
+	{
+		payload[i] = frame.payload[i];
+	}
+	return frame.length;
+}
+
+boolean Link_isUp(void)
+{
+	return g_linkUp;
+}
+
+void Link_getStats(Link_StatsType *stats)
+{
+	*stats = g_stats;
+}
@@ -15,32 +15,79 @@
 #include "uart.h"
 #include "std_types.h"
 #include "timer.h"
+#include "systick.h"
+#include "idle.h"
+#include "profile.h"
+#include "stack_monitor.h"
+#include "menu.h"
+#include "autobaud.h"
+#include "link.h"
+#include "speck.h"
+#include "cmac.h"
+#include "keystore.h"
+#include "config.h"
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 #include <util/delay.h>
+#include <string.h>
 
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
-#define PASSWORD_LENGTH 5
-#define ATTEMPTS_LIMIT 3
+#define PASSWORD_MIN_LENGTH 4
+#define PASSWORD_MAX_LENGTH 10
 #define START_COMMUNICATION 0x15
 #define ACKNOWLEDGE 0x16
 #define COMMAND_OPEN_DOOR '+'
 #define COMMAND_CHANGE_PASSWORD '-'
-#define WAIT_MESSAGE_COMMAND 0x20
-#define TRY_AGAIN 0x11
+#define COMMAND_SETTINGS 0x3B          // Password check that unlocks CONFIG_SET_COMMAND
+#define DOOR_EVENT_COMMAND 0x21
 #define ENTER_BUTTON 13
+#define BACKSPACE_KEY '%'              // Password entry: erase the last digit
+#define CLEAR_KEY '*'                  // Password entry: erase all digits
+#define CANCEL_KEY '='                 // Password entry: back to the menu (starts over while creating)
+#define ENTRY_CANCELLED 0              // readPassword result: CANCEL_KEY pressed
+#define ENTRY_LINK_FAILED 0xFF         // readPassword result: a streamed digit was not acknowledged
+#define PASSWORD_LOCKED 2              // Password verdict: Control_ECU is locked out after too many failures
+#define PASSWORD_MESSAGE_LENGTH (PASSWORD_MAX_LENGTH + 2)  // START, length, digits
+#define REPLY_TIMEOUT 2000             // ms for a reply, longer than Control_ECU's whole retransmission span
+#define EVENT_TIMEOUT 3000             // ms without a progress event before the link is considered lost
+#define DIAG_KEY '='                  // Hidden menu item showing the diagnostic pages
+#define DIAG_COMMAND 0x30              // Ask Control_ECU for its profiler report, PROFILE_ENABLE builds only
+#define DIAG_CHUNK_LENGTH (LINK_MAX_PAYLOAD - 2)  // Report bytes per reply: DIAG_COMMAND, offset, then the bytes
+#define SETTINGS_KEY 0                 // Hidden menu item for the installer settings, digits mean nothing else at the menu
+#define LINK_STATUS_COMMAND 0x35       // Ask Control_ECU for its receive error and link counters
+#define LINK_STATUS_LENGTH 15          // Reply: LINK_STATUS_COMMAND then 7 little-endian uint16 counters
+#define PAIR_COMMAND 0x36              // Ask a new Control_ECU for the link key
+#define DIGIT_COMMAND 0x37             // One password digit as it is typed: START_COMMUNICATION, position, digit
+#define LOCKOUT_STATUS_COMMAND 0x38    // Ask Control_ECU for the lockout time left
+#define LOCKOUT_STATUS_LENGTH 4        // Reply: LOCKOUT_STATUS_COMMAND, little-endian uint16 seconds left, attempts left
+#define CONFIG_GET_COMMAND 0x39        // Ask Control_ECU for the installer settings
+#define CONFIG_GET_LENGTH (1 + 2 * CONFIG_FIELDS)  // Reply: CONFIG_GET_COMMAND, then the fields as little-endian uint16
+#define CONFIG_SET_COMMAND 0x3A        // Change one setting: START_COMMUNICATION, field, value low, value high
+#define PASSWORD_STATUS_COMMAND 0x3C  // Ask Control_ECU whether a password is stored, reply 1 or 0
+#define PAIR_ATTEMPTS 3                // Pairing requests before giving up
+#define PASSWORD_SEND_ATTEMPTS 3       // New password sends, each after a relink, before going back to the menu
+#define CRYPTO_BENCH_RUNS 16           // Computations averaged by the crypto cost page
+#define BYTE_TIME_US 1042              // One 10-bit character at 9600 bps, the cost the PIN encryption is compared to
+#define BENCH_KEY '*'                 // Hidden menu item running the link benchmark, UART_FAULT_ENABLE builds only
+#define LINK_BENCH_COMMAND 0x34        // Benchmark exchange understood by Control_ECU
+#define BENCH_EXCHANGES 100            // Exchanges per benchmark run
+
+/* Progress events received from Control_ECU as DOOR_EVENT_COMMAND, event, value */
+#define EVENT_DOOR_OPENING 0x01        // value = percent of travel done
+#define EVENT_DOOR_HOLDING 0x02        // Motion detected, door held open
+#define EVENT_DOOR_CLOSING 0x03        // value = percent of travel done
+#define EVENT_DOOR_LOCKED 0x04         // Door cycle finished
 
 /*******************************************************************************
  *                           Global Variables                                  *
  *******************************************************************************/
 
 // Global variables
-uint8 password1[PASSWORD_LENGTH];
-uint8 password2[PASSWORD_LENGTH];
-uint8 enteredPassword[PASSWORD_LENGTH];
-uint8 attempts = 0;
+uint8 password1[PASSWORD_MAX_LENGTH];
+uint8 password2[PASSWORD_MAX_LENGTH];
 uint8 isPasswordSet = 0;
 
 
@@ -51,12 +98,40 @@ uint8 isPasswordSet = 0;
 // Function Prototypes
 void initializeSystem();
 void createPassword();
-void mainMenu();
 void handleOperation(uint8 command);
-void enterPassword(uint8 *passwordBuffer, const char* prompt);
-void sendPasswordToControlECU(uint8 password[]);
-void handleFailedAttempts();
-void displayWaitMessage();
-void enterPasswords(uint8 *passwordBuffer1,uint8 *passwordBuffer2);
+void handleSettings(uint8 key);
+uint8 enterPassword(const char* prompt);
+uint8 readPassword(uint8 *digits, boolean stream);
+boolean streamDigits(const uint8 *digits, uint8 *streamed, uint8 length);
+void showPasswordMask(uint8 length);
+boolean sendPasswordToControlECU(uint8 command, uint8 length, uint8 *response);
+boolean sendRequest(const uint8 *message, uint8 length, uint8 *reply);
+boolean sendSecretRequest(const uint8 *message, uint8 length, uint8 *reply);
+boolean receiveReply(uint8 *reply);
+void relink();
+boolean queryLockout(uint16 *remaining, uint8 *attemptsLeft);
+void waitForLockout();
+boolean fetchConfig();
+boolean queryPasswordSet();
+void editSettings();
+boolean storeSetting(uint8 field, uint16 value);
+boolean receiveDoorEvent(uint8 *event, uint8 *value);
+void followDoorCycle();
+void showDiagnostics(uint8 key);
+void showLinkStatus();
+void displayErrorCounts(uint8 tag, uint16 framing, uint16 parity, uint16 overrun, uint16 overflow);
+void setupLinkKey();
+#if PROFILE_ENABLE
+void showCryptoCost();
+boolean queryControlProfile(uint8 *report);
+void showControlProfile();
+uint16 measureMac(const Cmac_KeyType *key, uint8 length);
+uint16 measureCipher(const Speck_KeyType *key, uint8 length);
+#endif
+#if UART_FAULT_ENABLE
+void runLinkBenchmark(uint8 key);
+void displayTenths(uint16 value);
+#endif
+uint8 enterPasswords(uint8 *passwordBuffer1,uint8 *passwordBuffer2);
 
 #endif /* HMI_MAIN_H_ */
@@ -0,0 +1,106 @@
+ /******************************************************************************
+ *
+ * Module: Menu
+ *
+ * File Name: menu.c
+ *
+ * Description: Source file for the menu engine
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "menu.h"
+#include "lcd.h"
+#include "keypad.h"
+#include "idle.h"
+#include <avr/pgmspace.h>
+
+/* Copy a menu header or an item out of flash */
+static void Menu_readMenu(const Menu_Type *menu_P, Menu_Type *menu)
+{
+	memcpy_P(menu, menu_P, sizeof(Menu_Type));
+}
+
+static void Menu_readItem(const Menu_Type *menu, uint8 index, Menu_ItemType *item)
+{
+	memcpy_P(item, &menu->items[index], sizeof(Menu_ItemType));
+}
+
+/* Draw one page of the visible items, return the number of visible items */
+static uint8 Menu_render(const Menu_Type *menu, uint8 page)
+{
+	Menu_ItemType item;
+	uint8 visible = 0;
+	uint8 i;
+
+	LCD_clearScreen();
+	for (i = 0; i < menu->count; i++)
+	{
+		Menu_readItem(menu, i, &item);
+		if (item.label == NULL_PTR)
+		{
+			continue;  /* Hidden item: selectable, not drawn */
+		}
+		if (visible / MENU_LCD_ROWS == page)
+		{
+			LCD_displayStringRowColumn_P(visible % MENU_LCD_ROWS, 0, item.label);
+		}
+		visible++;
+	}
+	return visible;
+}
+
+void Menu_run(const Menu_Type *root)
+{
+	const Menu_Type *current_P = root;
+	Menu_Type menu;
+	Menu_ItemType item;
+	uint8 page = 0;
+	uint8 visible;
+	uint8 key;
+	uint8 i;
+
+	while (1)
+	{
+		Menu_readMenu(current_P, &menu);
+		visible = Menu_render(&menu, page);
+		key = KEYPAD_getPressedKey();
+		Idle_delayMs(MENU_DEBOUNCE_MS);
+
+		for (i = 0; i < menu.count; i++)
+		{
+			Menu_readItem(&menu, i, &item);
+			if (item.key == key)
+			{
+				break;
+			}
+		}
+
+		if (i < menu.count)
+		{
+			if (item.action != NULL_PTR)
+			{
+				item.action(key);
+				return;
+			}
+			current_P = item.submenu;  /* Descend, the table keeps the way back */
+			page = 0;
+		}
+		else if (key == MENU_KEY_NEXT_PAGE && visible > MENU_LCD_ROWS)
+		{
+			page = (page + 1) % ((visible + MENU_LCD_ROWS - 1) / MENU_LCD_ROWS);
+		}
+		else if (key == MENU_KEY_BACK && menu.parent != NULL_PTR)
+		{
+			current_P = menu.parent;
+			page = 0;
+		}
+		else
+		{
+			LCD_clearScreen();
+			LCD_displayStringRowColumn_P(1, 0, PSTR("Invalid Option"));
+			Idle_delayMs(1000);
+		}
+	}
+}
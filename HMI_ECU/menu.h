@@ -0,0 +1,60 @@
+ /******************************************************************************
+ *
+ * Module: Menu
+ *
+ * File Name: menu.h
+ *
+ * Description: Header file for the menu engine. A menu is a table of items
+ *              in flash (label, key, action or submenu); the engine draws
+ *              it on the LCD, reads the keypad and runs the selected item.
+ *              Navigation is iterative, no heap and no recursion.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef MENU_H_
+#define MENU_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define MENU_LCD_ROWS      2     /* Items shown per page */
+#define MENU_KEY_NEXT_PAGE 13    /* Enter: next page of a long menu */
+#define MENU_KEY_BACK      '%'   /* Back to the parent menu */
+#define MENU_DEBOUNCE_MS   500
+
+struct Menu_Type;
+
+/* One menu entry, stored in PROGMEM */
+typedef struct
+{
+    const char *label;                 // PROGMEM string, one LCD line; NULL_PTR hides the item
+    uint8 key;                         // Keypad key selecting the item
+    void (*action)(uint8 key);         // Run with the key when selected, or NULL_PTR for a submenu
+    const struct Menu_Type *submenu;   // Entered when action is NULL_PTR
+} Menu_ItemType;
+
+/* A menu, stored in PROGMEM */
+typedef struct Menu_Type
+{
+    const Menu_ItemType *items;        // PROGMEM array
+    uint8 count;
+    const struct Menu_Type *parent;    // NULL_PTR for the root menu
+} Menu_Type;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Show the menu and follow the keypad through its submenus until an action
+ * is selected, then run it and return. Unknown keys show "Invalid Option".
+ */
+void Menu_run(const Menu_Type *root);
+
+#endif /* MENU_H_ */
@@ -0,0 +1,118 @@
+ /******************************************************************************
+ *
+ * Module: Profiler
+ *
+ * File Name: profile.h
+ *
+ * Description: Header file for the CPU load and ISR latency profiler.
+ *              ISR durations are measured with TCNT1 of the system tick
+ *              (one count = 8 us at 8MHz). Build with PROFILE_ENABLE set
+ *              to 1 to use it; otherwise every hook expands to nothing.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE 0  /* 1 to build the profiler in, e.g. -DPROFILE_ENABLE=1 */
+#endif
+
+/* Profiled interrupts */
+typedef enum
+{
+    PROFILE_ISR_TIMER0_OVF,
+    PROFILE_ISR_TIMER0_COMP,
+    PROFILE_ISR_TIMER1_OVF,
+    PROFILE_ISR_TIMER1_COMPA,
+    PROFILE_ISR_TIMER2_OVF,
+    PROFILE_ISR_TIMER2_COMP,
+    PROFILE_ISR_ADC,
+    PROFILE_ISR_USART_RXC
+} Profile_IsrType;
+
+#define PROFILE_NUM_OF_ISRS 8
+
+/* Main loop iteration histogram bins: <1ms, <10ms, <100ms, <1s, >=1s */
+#define PROFILE_LOOP_BINS 5
+
+/* Bytes of a report, layout at Profile_getReport() */
+#define PROFILE_REPORT_LENGTH (PROFILE_NUM_OF_ISRS * 8 + PROFILE_LOOP_BINS * 2 + 5)
+
+typedef struct
+{
+    uint32 calls;
+    uint32 totalUs;   // Time spent in the handler since the last reset
+    uint16 maxUs;     // Longest single run, interrupts stay masked at least this long
+} Profile_IsrStatsType;
+
+#if PROFILE_ENABLE
+
+/* Put PROFILE_ISR_ENTER() first and PROFILE_ISR_EXIT() last in an ISR body */
+#define PROFILE_ISR_ENTER()      uint16 profileStart = Profile_isrEnter()
+#define PROFILE_ISR_EXIT(isr)    Profile_isrExit((isr), profileStart)
+#define PROFILE_LOOP_MARK()      Profile_loopMark()
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Timestamp of an ISR entry in TCNT1 counts. Used by PROFILE_ISR_ENTER().
+ */
+uint16 Profile_isrEnter(void);
+
+/*
+ * Description :
+ * Account one run of an ISR started at the given timestamp. Used by
+ * PROFILE_ISR_EXIT().
+ */
+void Profile_isrExit(Profile_IsrType isr, uint16 start);
+
+/*
+ * Description :
+ * Mark the start of a main loop iteration; the time since the previous mark
+ * goes into the iteration histogram.
+ */
+void Profile_loopMark(void);
+
+/*
+ * Description :
+ * Copy the statistics of one ISR.
+ */
+void Profile_getIsrStats(Profile_IsrType isr, Profile_IsrStatsType *stats);
+
+/*
+ * Description :
+ * Fill a PROFILE_REPORT_LENGTH bytes report and start a new window. Layout,
+ * multi-byte values little endian:
+ * PROFILE_NUM_OF_ISRS x (calls u32, average us u16, max us u16),
+ * PROFILE_LOOP_BINS x count u16, idle percent u8, max wake latency us u16,
+ * smallest stack headroom since reset u16.
+ */
+void Profile_getReport(uint8 *report);
+
+/*
+ * Description :
+ * Clear all counters.
+ */
+void Profile_reset(void);
+
+#else
+
+#define PROFILE_ISR_ENTER()
+#define PROFILE_ISR_EXIT(isr)
+#define PROFILE_LOOP_MARK()
+
+#endif /* PROFILE_ENABLE */
+
+#endif /* PROFILE_H_ */
@@ -0,0 +1,64 @@
+ /******************************************************************************
+ *
+ * Module: Speck
+ *
+ * File Name: speck.h
+ *
+ * Description: Header file for the Speck64/128 block cipher (64-bit block,
+ *              128-bit key, 27 rounds) and its counter mode. Bytes are read
+ *              little-endian, as in the test vectors of the Speck designers.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef SPECK_H_
+#define SPECK_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define SPECK_BLOCK_SIZE    8
+#define SPECK_KEY_SIZE      16
+#define SPECK_ROUNDS        27
+#define SPECK_NONCE_SIZE    7   /* Counter block: nonce, then the block number */
+
+typedef struct
+{
+    uint32 roundKeys[SPECK_ROUNDS];
+} Speck_KeyType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Expand a SPECK_KEY_SIZE byte key into the round keys.
+ */
+void Speck_setKey(Speck_KeyType *ctx, const uint8 *key);
+
+/*
+ * Description :
+ * Encrypt one SPECK_BLOCK_SIZE byte block in place.
+ */
+void Speck_encrypt(const Speck_KeyType *ctx, uint8 *block);
+
+/*
+ * Description :
+ * Encrypt or decrypt length bytes in place in counter mode. A nonce must
+ * never be used twice with the same key.
+ */
+void Speck_ctr(const Speck_KeyType *ctx, const uint8 *nonce, uint8 *data, uint8 length);
+
+/*
+ * Description :
+ * Check the cipher against the published Speck64/128 test vector, and the
+ * counter mode against a vector of our own.
+ */
+boolean Speck_selfTest(void);
+
+#endif /* SPECK_H_ */
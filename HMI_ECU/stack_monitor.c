@@ -0,0 +1,56 @@
+ /******************************************************************************
+ *
+ * Module: Stack Monitor
+ *
+ * File Name: stack_monitor.c
+ *
+ * Description: Source file for the stack high-water mark
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "stack_monitor.h"
+
+extern uint8 _end;      /* End of .bss (and start of the unused heap), from the linker */
+extern uint8 __stack;   /* Top of RAM */
+
+void StackMonitor_paint(void) __attribute__((naked, used, section(".init1")));
+
+/*
+ * Runs from .init1, right after reset and before the C runtime sets up the
+ * stack, so it must not use the stack: plain assembly, no frame.
+ */
+void StackMonitor_paint(void)
+{
+	__asm__ __volatile__ (
+		"    ldi r30, lo8(_end)\n"
+		"    ldi r31, hi8(_end)\n"
+		"    ldi r24, %0\n"
+		"    ldi r25, hi8(__stack)\n"
+		"    rjmp 2f\n"
+		"1:  st Z+, r24\n"
+		"2:  cpi r30, lo8(__stack)\n"
+		"    cpc r31, r25\n"
+		"    brlo 1b\n"
+		"    breq 1b\n"
+		:: "M" (STACK_CANARY));
+}
+
+uint16 StackMonitor_getFreeBytes(void)
+{
+	const volatile uint8 *p = &_end;
+	uint16 count = 0;
+
+	while (p <= &__stack && *p == STACK_CANARY)
+	{
+		p++;
+		count++;
+	}
+	return count;
+}
+
+uint16 StackMonitor_getMaxUsage(void)
+{
+	return (uint16)(&__stack - &_end) + 1 - StackMonitor_getFreeBytes();
+}
@@ -0,0 +1,45 @@
+ /******************************************************************************
+ *
+ * Module: Stack Monitor
+ *
+ * File Name: stack_monitor.h
+ *
+ * Description: Header file for the stack high-water mark. The RAM between
+ *              the end of .bss and the top of RAM is filled with a canary
+ *              byte before main() runs; the canary bytes never overwritten
+ *              give the smallest stack headroom seen since reset.
+ *              tools/sram_report.py gives the static side of the budget.
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#ifndef STACK_MONITOR_H_
+#define STACK_MONITOR_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+
+#define STACK_CANARY 0xC5
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Smallest number of bytes that were left between .bss and the stack since
+ * reset. Scans the painted area, so call it from diagnostics only.
+ */
+uint16 StackMonitor_getFreeBytes(void);
+
+/*
+ * Description :
+ * Deepest stack use since reset in bytes, interrupts included.
+ */
+uint16 StackMonitor_getMaxUsage(void);
+
+#endif /* STACK_MONITOR_H_ */
@@ -0,0 +1,107 @@
+ /******************************************************************************
+ *
+ * Module: System Tick
+ *
+ * File Name: systick.c
+ *
+ * Description: Source file for the 1 ms monotonic timebase on Timer1
+ *
+ * Author: Mohamed Bahaa
+ *
+ *******************************************************************************/
+
+#include "systick.h"
+#include "timer.h"
+#include "common_macros.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+static volatile uint32 g_millis = 0;
+static uint16 g_fraction = 0;  /* Accumulated fractional counts, in 1/1000 count */
+
+/* Called from the Timer1 compare interrupt once per millisecond */
+static void Systick_tick(void)
+{
+	g_millis++;
+
+#if (SYSTICK_FRACTION_PER_MS != 0)
+	/*
+	 * In CTC mode OCR1A is not double buffered and TCNT1 has just been
+	 * cleared, so the new TOP applies to the period that is starting now.
+	 */
+	g_fraction += SYSTICK_FRACTION_PER_MS;
+	if (g_fraction >= 1000)
+	{
+		g_fraction -= 1000;
+		OCR1A = SYSTICK_COUNTS_PER_MS;      /* One count longer */
+	}
+	else
+	{
+		OCR1A = SYSTICK_COUNTS_PER_MS - 1;
+	}
+#endif
+}
+
+void Systick_init(void)
+{
+	if (!Timer_claim(TIMER_1, TIMER_RES_CLOCK | TIMER_RES_COMP, TIMER_OWNER_SYSTICK))
+	{
+		return;  /* Reported by Timer_hasConflict() */
+	}
+
+	/* CTC mode with TOP = OCR1A, F_CPU/64 */
+	TCCR1A = 0;
+	TCNT1 = 0;
+	OCR1A = SYSTICK_COUNTS_PER_MS - 1;
+	TCCR1B = (1 << WGM12) | (1 << CS11) | (1 << CS10);
+
+	Timer_addCallBack(Systick_tick, TIMER_1);
+	TIFR = (1 << OCF1A);
+	TIMSK |= (1 << OCIE1A);
+}
+
+uint32 Systick_getMillis(void)
+{
+	uint32 millis;
+	uint8 sreg = SREG;
+
+	cli();
+	millis = g_millis;
+	SREG = sreg;
+	return millis;
+}
+
+uint32 Systick_getMicros(void)
+{
+	uint32 millis;
+	uint16 counts;
+	uint8 sreg = SREG;
+
+	cli();
+	millis = g_millis;
+	counts = TCNT1;
+	/* A compare match not serviced yet means TCNT1 already restarted from 0 */
+	if (BIT_IS_SET(TIFR,OCF1A) && counts < (SYSTICK_COUNTS_PER_MS / 2))
+	{
+		millis++;
+	}
+	SREG = sreg;
+
+	return millis * 1000UL + ((uint32)counts * SYSTICK_PRESCALER) / (F_CPU / 1000000UL);
+}
+
+uint16 Systick_getTickPhaseUs(void)
+{
+	uint16 counts;
+	uint8 sreg = SREG;
+
+	cli();  // TCNT1 is read through the shared 16-bit TEMP register
+	counts = TCNT1;
+	SREG = sreg;
+	return (uint16)(((uint32)counts * SYSTICK_PRESCALER) / (F_CPU / 1000000UL));
+}
+
+uint32 Systick_elapsedSince(uint32 start)
+{
+	return Systick_getMillis() - start;
+}
@@ -7,15 +7,87 @@
 
 
 #include "timer.h"
+#include "profile.h"
 
 
-/* Global pointers to callback functions for each timer */
-static void (*g_timer0CallBackPtr)(void) = NULL_PTR;
-static void (*g_timer1CallBackPtr)(void) = NULL_PTR;
-static void (*g_timer2CallBackPtr)(void) = NULL_PTR;
+/* Global pointers to callback functions for each timer, shared by all its interrupts (only one is ever enabled, see Timer_claim) */
+static void (*g_timerCallBackPtr[3][TIMER_MAX_CALLBACKS])(void);
+
+/* Owner of every resource bit of every timer */
+#define TIMER_NUM_OF_RESOURCES 5
+static uint8 g_timerOwner[3][TIMER_NUM_OF_RESOURCES];
+static boolean g_timerConflict = FALSE;
+
+/* Call every callback registered on a timer */
+static void Timer_dispatch(Timer_ID_Type timer) {
+	uint8 i;
+	for (i = 0; i < TIMER_MAX_CALLBACKS; i++) {
+		if (g_timerCallBackPtr[timer][i] != NULL_PTR) {
+			(*g_timerCallBackPtr[timer][i])();
+		}
+	}
+}
+
+/* Timer resource registry */
+boolean Timer_claim(Timer_ID_Type timer, Timer_ResourceType resources, Timer_OwnerType owner) {
+	Timer_ResourceType held = 0;
+	uint8 bit;
+	uint8 sreg = SREG;
+
+	cli();  // PWM_setCallBack() claims from the main loop while timer interrupts run
+	/* Check every requested resource before taking any of them */
+	for (bit = 0; bit < TIMER_NUM_OF_RESOURCES; bit++) {
+		if (g_timerOwner[timer][bit] == TIMER_OWNER_NONE) {
+			continue;
+		}
+		held |= (1 << bit);
+		if ((resources & (1 << bit)) && g_timerOwner[timer][bit] != owner) {
+			g_timerConflict = TRUE;
+			SREG = sreg;
+			return FALSE;
+		}
+	}
+	/* The callbacks of a timer run on both its vectors: only one of them may be used */
+	if (((resources | held) & (TIMER_RES_OVF | TIMER_RES_COMP)) == (TIMER_RES_OVF | TIMER_RES_COMP)) {
+		g_timerConflict = TRUE;
+		SREG = sreg;
+		return FALSE;
+	}
+	for (bit = 0; bit < TIMER_NUM_OF_RESOURCES; bit++) {
+		if (resources & (1 << bit)) {
+			g_timerOwner[timer][bit] = owner;
+		}
+	}
+	SREG = sreg;
+	return TRUE;
+}
+
+void Timer_release(Timer_ID_Type timer, Timer_ResourceType resources, Timer_OwnerType owner) {
+	uint8 bit;
+	uint8 sreg = SREG;
+
+	cli();
+	for (bit = 0; bit < TIMER_NUM_OF_RESOURCES; bit++) {
+		if ((resources & (1 << bit)) && g_timerOwner[timer][bit] == owner) {
+			g_timerOwner[timer][bit] = TIMER_OWNER_NONE;
+		}
+	}
+	SREG = sreg;
+}
+
+boolean Timer_hasConflict(void) {
+	return g_timerConflict;
+}
 
 /* Timer initialization function */
 void Timer_init(const Timer_ConfigType *Config_Ptr) {
+	/* The timebase and the interrupt it uses must be free (or already ours) */
+	if (!Timer_claim(Config_Ptr->timer_ID,
+			TIMER_RES_CLOCK | ((Config_Ptr->timer_mode == TIMER_NORMAL_MODE) ? TIMER_RES_OVF : TIMER_RES_COMP),
+			TIMER_OWNER_TIMER)) {
+		return;
+	}
+
 	switch (Config_Ptr->timer_ID) {
 	case TIMER_0:
 		/* Set initial value */
@@ -90,6 +162,11 @@ void Timer_init(const Timer_ConfigType *Config_Ptr) {
 
 /* Timer de-initialization function */
 void Timer_deInit(Timer_ID_Type timer_type) {
+	/* Only stops the timer: the claim is kept so the next Timer_init() cannot be refused */
+	if (g_timerOwner[timer_type][0] != TIMER_OWNER_TIMER) {
+		return;  /* Not started by Timer_init(), leave the owner's setup alone */
+	}
+
 	switch (timer_type) {
 	case TIMER_0:
 		TCCR0 = 0;
@@ -106,59 +183,96 @@ void Timer_deInit(Timer_ID_Type timer_type) {
 	}
 }
 
-/* Set callback function for timer interrupts */
+/* Set callback function for timer interrupts (replaces all registered callbacks) */
 void Timer_setCallBack(void(*a_ptr)(void), Timer_ID_Type a_timer_ID) {
-	switch (a_timer_ID) {
-	case TIMER_0:
-		g_timer0CallBackPtr = a_ptr;
-		break;
-	case TIMER_1:
-		g_timer1CallBackPtr = a_ptr;
-		break;
-	case TIMER_2:
-		g_timer2CallBackPtr = a_ptr;
-		break;
+	uint8 i;
+	uint8 sreg = SREG;
+
+	cli();  // The interrupts read these 16-bit pointers: never let them see half of one
+	for (i = 0; i < TIMER_MAX_CALLBACKS; i++) {
+		g_timerCallBackPtr[a_timer_ID][i] = NULL_PTR;
 	}
+	g_timerCallBackPtr[a_timer_ID][0] = a_ptr;
+	SREG = sreg;
+}
+
+/* Add a callback next to the ones already registered on a timer */
+boolean Timer_addCallBack(void(*a_ptr)(void), Timer_ID_Type a_timer_ID) {
+	uint8 i;
+	boolean added = FALSE;
+	uint8 sreg = SREG;
+
+	cli();
+	for (i = 0; i < TIMER_MAX_CALLBACKS && !added; i++) {
+		if (g_timerCallBackPtr[a_timer_ID][i] == a_ptr) {
+			added = TRUE;  /* Already registered */
+		}
+	}
+	for (i = 0; i < TIMER_MAX_CALLBACKS && !added; i++) {
+		if (g_timerCallBackPtr[a_timer_ID][i] == NULL_PTR) {
+			g_timerCallBackPtr[a_timer_ID][i] = a_ptr;
+			added = TRUE;
+		}
+	}
+	if (!added) {
+		g_timerConflict = TRUE;  /* A user left without its callback must not go unnoticed */
+	}
+	SREG = sreg;
+	return added;
+}
+
+/* Remove one callback from a timer */
+void Timer_removeCallBack(void(*a_ptr)(void), Timer_ID_Type a_timer_ID) {
+	uint8 i;
+	uint8 sreg = SREG;
+
+	cli();
+	for (i = 0; i < TIMER_MAX_CALLBACKS; i++) {
+		if (g_timerCallBackPtr[a_timer_ID][i] == a_ptr) {
+			g_timerCallBackPtr[a_timer_ID][i] = NULL_PTR;
+		}
+	}
+	SREG = sreg;
 }
 
 /* ISR for TIMER0 overflow */
 ISR(TIMER0_OVF_vect) {
-	if (g_timer0CallBackPtr != NULL_PTR) {
-		(*g_timer0CallBackPtr)();
-	}
+	PROFILE_ISR_ENTER();
+	Timer_dispatch(TIMER_0);
+	PROFILE_ISR_EXIT(PROFILE_ISR_TIMER0_OVF);
 }
 
 /* ISR for TIMER0 compare match */
 ISR(TIMER0_COMP_vect) {
-	if (g_timer0CallBackPtr != NULL_PTR) {
-		(*g_timer0CallBackPtr)();
-	}
+	PROFILE_ISR_ENTER();
+	Timer_dispatch(TIMER_0);
+	PROFILE_ISR_EXIT(PROFILE_ISR_TIMER0_COMP);
 }
 
 /* ISR for TIMER1 overflow */
 ISR(TIMER1_OVF_vect) {
-	if (g_timer1CallBackPtr != NULL_PTR) {
-		(*g_timer1CallBackPtr)();
-	}
+	PROFILE_ISR_ENTER();
+	Timer_dispatch(TIMER_1);
+	PROFILE_ISR_EXIT(PROFILE_ISR_TIMER1_OVF);
 }
 
 /* ISR for TIMER1 compare match */
 ISR(TIMER1_COMPA_vect) {
-	if (g_timer1CallBackPtr != NULL_PTR) {
-		(*g_timer1CallBackPtr)();
-	}
+	PROFILE_ISR_ENTER();
+	Timer_dispatch(TIMER_1);
+	PROFILE_ISR_EXIT(PROFILE_ISR_TIMER1_COMPA);
 }
 
 /* ISR for TIMER2 overflow */
 ISR(TIMER2_OVF_vect) {
-	if (g_timer2CallBackPtr != NULL_PTR) {
-		(*g_timer2CallBackPtr)();
-	}
+	PROFILE_ISR_ENTER();
+	Timer_dispatch(TIMER_2);
+	PROFILE_ISR_EXIT(PROFILE_ISR_TIMER2_OVF);
 }
 
 /* ISR for TIMER2 compare match */
 ISR(TIMER2_COMP_vect) {
-	if (g_timer2CallBackPtr != NULL_PTR) {
-		(*g_timer2CallBackPtr)();
-	}
+	PROFILE_ISR_ENTER();
+	Timer_dispatch(TIMER_2);
+	PROFILE_ISR_EXIT(PROFILE_ISR_TIMER2_COMP);
 }
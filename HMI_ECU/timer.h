@@ -15,17 +15,12 @@
  *******************************************************************************/
 
 #define NULL_PTR ((void*)0)  // Define NULL_PTR as a null pointer
-
-/* Define types for timer configuration settings */
-
-// Timer ID Type
 typedef enum
 {
     TIMER_0 = 0,
     TIMER_1,
     TIMER_2
 } Timer_ID_Type;
-
 // Timer Clock Type
 typedef enum
 {
@@ -42,9 +37,33 @@ typedef enum
     TIMER_NORMAL_MODE = 0,
     TIMER_COMPARE_MODE
 } Timer_ModeType;
+
 /* Enum for Timer IDs */
 
 
+/* Timer resources handed out by Timer_claim(), one bit each */
+typedef uint8 Timer_ResourceType;
+#define TIMER_RES_CLOCK  0x01  // Mode and clock select: the timebase itself
+#define TIMER_RES_OVF    0x02  // Overflow interrupt
+#define TIMER_RES_COMP   0x04  // Compare match interrupt (COMPA on Timer1)
+#define TIMER_RES_OCA    0x08  // OC0 / OC1A / OC2 output pin and compare register
+#define TIMER_RES_OCB    0x10  // OC1B output pin and compare register (Timer1 only)
+
+/* Logical owners of timer resources */
+typedef enum
+{
+    TIMER_OWNER_NONE = 0,
+    TIMER_OWNER_TIMER,     // Timer_init() users (periodic ticks)
+    TIMER_OWNER_PWM,       // PWM driver
+    TIMER_OWNER_SYSTICK    // 1 ms system tick (Timer1)
+} Timer_OwnerType;
+
+/*
+ * Maximum number of callbacks sharing the interrupts of one timer. Control_ECU
+ * puts three on Timer1 (system tick, buzzer, ADC slow scan), one is spare.
+ */
+#define TIMER_MAX_CALLBACKS 4
+
 /* Timer configuration structure */
 typedef struct
 {
@@ -65,4 +84,41 @@ void Timer_init(const Timer_ConfigType *Config_Ptr);
 void Timer_deInit(Timer_ID_Type timer_type);
 void Timer_setCallBack(void(*a_ptr)(void), Timer_ID_Type a_timer_ID);
 
+/*
+ * Description :
+ * Add a callback to the interrupts of a timer without removing the ones
+ * already registered, so several logical users can share one timebase.
+ * Returns FALSE when TIMER_MAX_CALLBACKS are in use, latched like a refused
+ * claim so that Timer_hasConflict() can stop the boot.
+ */
+boolean Timer_addCallBack(void(*a_ptr)(void), Timer_ID_Type a_timer_ID);
+
+/*
+ * Description :
+ * Remove a callback added with Timer_addCallBack().
+ */
+void Timer_removeCallBack(void(*a_ptr)(void), Timer_ID_Type a_timer_ID);
+
+/*
+ * Description :
+ * Hand timer resources to an owner. Claiming resources already held by the
+ * same owner is allowed; a claim overlapping another owner is refused and
+ * latched so that Timer_hasConflict() can stop the boot. The callbacks of a
+ * timer run on whichever of its interrupts fires, so TIMER_RES_OVF and
+ * TIMER_RES_COMP of one timer are never handed out together.
+ */
+boolean Timer_claim(Timer_ID_Type timer, Timer_ResourceType resources, Timer_OwnerType owner);
+
+/*
+ * Description :
+ * Give back resources claimed by an owner.
+ */
+void Timer_release(Timer_ID_Type timer, Timer_ResourceType resources, Timer_OwnerType owner);
+
+/*
+ * Description :
+ * Return TRUE if any claim or callback was refused since reset.
+ */
+boolean Timer_hasConflict(void);
+
 #endif /* TIMER_H_ */
@@ -13,11 +13,59 @@
 #include "uart.h"
 #include "avr/io.h" /* To use the UART Registers */
 #include "common_macros.h" /* To use the macros like SET_BIT */
+#include "idle.h" /* To sleep while waiting for data */
+#include "profile.h" /* To time the Rx interrupt */
+#include "systick.h" /* For the receive timeout */
+#include <avr/interrupt.h>
 
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
 
+/* Received bytes, filled by the Rx complete interrupt so they are not lost while sleeping */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0;  // Written by the ISR
+static volatile uint8 g_rxTail = 0;  // Written by the reader
+static boolean g_txUsed = FALSE;     // TXC only means something once a byte was sent
+static volatile UART_ErrorStatsType g_errorStats;  // Written by the ISR
+
+#if UART_FAULT_ENABLE
+static UART_FaultModelType g_faultModel = {UART_FAULT_DROP, UART_FAULT_DUPLICATE, UART_FAULT_CORRUPT, UART_FAULT_JITTER_MS};
+static UART_FaultStatsType g_faultStats;
+static uint16 g_faultRandom = 0xACE1;  // Generator state, any non-zero seed
+#endif
+
+ISR(USART_RXC_vect)
+{
+	PROFILE_ISR_ENTER();
+	/* The error flags describe the byte in UDR, so they must be read first */
+	uint8 status = UCSRA;
+	uint8 data = UDR;
+	uint8 next = (g_rxHead + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+	if (status & (1 << DOR))
+	{
+		g_errorStats.overrun++;  /* Bytes before this one were lost, this one is sound */
+	}
+	if (status & (1 << FE))
+	{
+		g_errorStats.framing++;  /* Corrupted byte, never handed to the application */
+	}
+	else if (status & (1 << PE))
+	{
+		g_errorStats.parity++;
+	}
+	else if (next != g_rxTail)
+	{
+		g_rxBuffer[g_rxHead] = data;
+		g_rxHead = next;
+	}
+	else
+	{
+		g_errorStats.overflow++;  /* On overflow the newest byte is dropped, as the hardware would do */
+	}
+	PROFILE_ISR_EXIT(PROFILE_ISR_USART_RXC);
+}
 
 
 /*******************************************************************************
@@ -25,64 +73,121 @@
  *******************************************************************************/
 
 
+/*
+ * UBRR value for a baud rate in double speed mode, rounded to the nearest
+ * divider, or 0xFFFF if the rate cannot be reached.
+ */
+static uint16 UART_calcUbrr(uint32 baud_rate)
+{
+    uint32 ubrr;
+
+    if (baud_rate == 0 || baud_rate > F_CPU / 8UL)
+    {
+        return 0xFFFF;
+    }
+    ubrr = (F_CPU + 4UL * baud_rate) / (8UL * baud_rate) - 1;
+    return (ubrr > 4095) ? 0xFFFF : (uint16)ubrr;
+}
+
 /* UART_init to use UART_ConfigType */
-void UART_init(const UART_ConfigType *Config_Ptr)
+boolean UART_init(const UART_ConfigType *Config_Ptr)
 {
-    uint16 ubrr_value = 0;
+    uint16 ubrr_value = UART_calcUbrr(Config_Ptr->baud_rate);
+    uint8 ucsrc = (1 << URSEL);  /* Frame format, written to UCSRC at the end */
+
+    /* Refuse a rate the other side could not sample reliably */
+    if (ubrr_value == 0xFFFF || UART_getBaudError(Config_Ptr->baud_rate) > UART_MAX_BAUD_ERROR ||
+        UART_getBaudError(Config_Ptr->baud_rate) < -UART_MAX_BAUD_ERROR)
+    {
+        return FALSE;
+    }
 
     /* U2X = 1 for double transmission speed */
     UCSRA = (1 << U2X);
 
     /* Configure UCSRB based on data bits */
-    UCSRB = (1 << RXEN) | (1 << TXEN);
+    UCSRB = (1 << RXEN) | (1 << TXEN) | (1 << RXCIE);
     if (Config_Ptr->bit_data == 9) {
-        UCSRB |= (1<<URSEL) |(1 << UCSZ2);  // Set for 9-bit data mode if specified
+        UCSRB |= (1 << UCSZ2);  // Set for 9-bit data mode if specified
     }
 
-    /* Configure UCSRC for frame format, parity, and stop bits */
+    /*
+     * UCSRC shares its address with UBRRH: a read returns UBRRH and a write
+     * only reaches UCSRC with URSEL set, so the frame format is built in a
+     * local and written once.
+     */
 
-
-    /* Configure data bit size */
-    if (Config_Ptr->bit_data == 8) {
-        UCSRC |=(1<<URSEL) | (1 << UCSZ1) | (1 << UCSZ0);  // 8-bit data
+    /* Configure data bit size, 5-bit data is UCSZ2:0 = 0 */
+    if (Config_Ptr->bit_data == 8 || Config_Ptr->bit_data == 9) {
+        ucsrc |= (1 << UCSZ1) | (1 << UCSZ0);  // 8-bit data, or 9-bit with UCSZ2
     } else if (Config_Ptr->bit_data == 7) {
-        UCSRC |= (1<<URSEL) |(1 << UCSZ1);                 // 7-bit data
+        ucsrc |= (1 << UCSZ1);                 // 7-bit data
+    } else if (Config_Ptr->bit_data == 6) {
+        ucsrc |= (1 << UCSZ0);                 // 6-bit data
     }
-    else if (Config_Ptr->bit_data == 6) {
-            UCSRC |= (1<<URSEL) |(1 << UCSZ0);                 // 6-bit data
-        }
-    else if (Config_Ptr->bit_data == 5) {
-            UCSRC &=~ (1 << UCSZ0);                 // 5-bit data
-            UCSRC &=~ (1 << UCSZ1);
-            UCSRC &=~ (1 << UCSZ2);
-        }
-
 
     /* Configure parity */
     if (Config_Ptr->parity == 1) {
-        UCSRC |= (1 << UPM1);  // Even parity
+        ucsrc |= (1 << UPM1);  // Even parity
     } else if (Config_Ptr->parity == 2) {
-        UCSRC |= (1 << UPM1) | (1 << UPM0);  // Odd parity
+        ucsrc |= (1 << UPM1) | (1 << UPM0);  // Odd parity
     }
 
     /* Configure stop bits */
     if (Config_Ptr->stop_bit == 2) {
-        UCSRC |= (1 << USBS);  // 2 stop bits
+        ucsrc |= (1 << USBS);  // 2 stop bits
     }
-
-    /* Calculate the UBRR register value for the specified baud rate */
-    ubrr_value = (uint16_t)((F_CPU / (Config_Ptr->baud_rate * 8UL)) - 1);
+    UCSRC = ucsrc;
 
     /* Set UBRR register */
     UBRRH = ubrr_value >> 8;
     UBRRL = ubrr_value;
+    return TRUE;
 }
 
 /*
  * Description :
- * Functional responsible for send byte to another UART device.
+ * Error of the baud rate actually generated for a requested rate, in 0.1%.
  */
-void UART_sendByte(const uint8 data)
+sint16 UART_getBaudError(uint32 baud_rate)
+{
+    uint16 ubrr = UART_calcUbrr(baud_rate);
+    sint32 actual;
+
+    if (ubrr == 0xFFFF)
+    {
+        return 0x7FFF;
+    }
+    actual = (sint32)(F_CPU / (8UL * (ubrr + 1)));
+    return (sint16)(((actual - (sint32)baud_rate) * 1000L) / (sint32)baud_rate);
+}
+
+/*
+ * Description :
+ * Switch to another baud rate once the last byte has left the shift register.
+ */
+boolean UART_setBaudRate(uint32 baud_rate)
+{
+    uint16 ubrr_value = UART_calcUbrr(baud_rate);
+    sint16 error = UART_getBaudError(baud_rate);
+
+    if (ubrr_value == 0xFFFF || error > UART_MAX_BAUD_ERROR || error < -UART_MAX_BAUD_ERROR)
+    {
+        return FALSE;
+    }
+
+    while(BIT_IS_CLEAR(UCSRA,UDRE)){}
+    if (g_txUsed)
+    {
+        while(BIT_IS_CLEAR(UCSRA,TXC)){}
+    }
+    UBRRH = ubrr_value >> 8;
+    UBRRL = ubrr_value;
+    return TRUE;
+}
+
+/* Put one byte on the line */
+static void UART_transmit(uint8 data)
 {
 	/*
 	 * UDRE flag is set when the Tx buffer (UDR) is empty and ready for
@@ -90,6 +195,13 @@ void UART_sendByte(const uint8 data)
 	 */
 	while(BIT_IS_CLEAR(UCSRA,UDRE)){}
 
+	/*
+	 * Clear TXC (write one) so UART_setBaudRate() can wait for this byte. A
+	 * read-modify-write would also write back FE, DOR and PE; only U2X is kept.
+	 */
+	UCSRA = (UCSRA & (1 << U2X)) | (1 << TXC);
+	g_txUsed = TRUE;
+
 	/*
 	 * Put the required data in the UDR register and it also clear the UDRE flag as
 	 * the UDR register is not empty now
@@ -103,20 +215,136 @@ void UART_sendByte(const uint8 data)
 	*******************************************************************/
 }
 
+#if UART_FAULT_ENABLE
+/* 16-bit xorshift (7, 9, 8): full period and cheap on an 8-bit core */
+static uint16 UART_faultNext(void)
+{
+	g_faultRandom ^= g_faultRandom << 7;
+	g_faultRandom ^= g_faultRandom >> 9;
+	g_faultRandom ^= g_faultRandom << 8;
+	return g_faultRandom;
+}
+
+void UART_setFaultModel(const UART_FaultModelType *model)
+{
+	g_faultModel = *model;
+}
+
+void UART_getFaultStats(UART_FaultStatsType *stats)
+{
+	*stats = g_faultStats;
+}
+#endif
+
+/*
+ * Description :
+ * Functional responsible for send byte to another UART device.
+ */
+void UART_sendByte(const uint8 data)
+{
+#if UART_FAULT_ENABLE
+	uint8 byte = data;
+
+	if (g_faultModel.jitterMaxMs != 0)
+	{
+		uint8 delay = UART_faultNext() % (g_faultModel.jitterMaxMs + 1);
+		if (delay != 0)
+		{
+			Idle_delayMs(delay);
+		}
+	}
+	if (UART_faultNext() < g_faultModel.dropRate)
+	{
+		g_faultStats.dropped++;
+		return;
+	}
+	if (UART_faultNext() < g_faultModel.corruptRate)
+	{
+		byte ^= (uint8)(1 << (UART_faultNext() & 0x07));
+		g_faultStats.corrupted++;
+	}
+	UART_transmit(byte);
+	if (UART_faultNext() < g_faultModel.duplicateRate)
+	{
+		UART_transmit(byte);
+		g_faultStats.duplicated++;
+	}
+#else
+	UART_transmit(data);
+#endif
+}
+
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
  */
 uint8 UART_recieveByte(void)
 {
-	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
-	while(BIT_IS_CLEAR(UCSRA,RXC)){}
+	uint8 data;
 
-	/*
-	 * Read the received data from the Rx buffer (UDR)
-	 * The RXC flag will be cleared after read the data
-	 */
-    return UDR;		
+	/* The Rx complete interrupt wakes the CPU, so sleep until a byte is buffered */
+	while(g_rxHead == g_rxTail)
+	{
+		Idle_sleepUnless(UART_isDataAvailable);
+	}
+
+	data = g_rxBuffer[g_rxTail];
+	g_rxTail = (g_rxTail + 1) & (UART_RX_BUFFER_SIZE - 1);
+	return data;
+}
+
+/*
+ * Description :
+ * Receive a byte, giving up after timeout_ms milliseconds. Returns FALSE on timeout.
+ */
+boolean UART_receiveByteTimeout(uint8 *data, uint16 timeout_ms)
+{
+	uint32 start = Systick_getMillis();
+
+	while(g_rxHead == g_rxTail)
+	{
+		if (Systick_elapsedSince(start) > timeout_ms)
+		{
+			return FALSE;
+		}
+		Idle_sleepUnless(UART_isDataAvailable);
+	}
+	*data = UART_recieveByte();
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Drop every byte waiting in the Rx buffer.
+ */
+void UART_flushRx(void)
+{
+	g_rxTail = g_rxHead;
+}
+
+/*
+ * Description :
+ * Return TRUE if a received byte is waiting in the Rx buffer, without blocking.
+ */
+boolean UART_isDataAvailable(void)
+{
+	return (g_rxHead != g_rxTail) ? TRUE : FALSE;
+}
+
+/*
+ * Description :
+ * Copy the receive error counters, consistent with each other.
+ */
+void UART_getErrorStats(UART_ErrorStatsType *stats)
+{
+	uint8 sreg = SREG;
+
+	cli();
+	stats->framing = g_errorStats.framing;
+	stats->overrun = g_errorStats.overrun;
+	stats->parity = g_errorStats.parity;
+	stats->overflow = g_errorStats.overflow;
+	SREG = sreg;
 }
 
 /*
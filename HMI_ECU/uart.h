@@ -32,6 +32,59 @@ typedef struct
     UART_BaudRateType baud_rate;   // Baud rate (e.g., 9600, 115200)
 } UART_ConfigType;
 
+/* Receive buffer filled by the Rx complete interrupt, must be a power of 2 (holds a whole link frame) */
+#define UART_RX_BUFFER_SIZE 32
+
+/* Largest baud rate error accepted, in 0.1% (a receiver tolerates about 2% each side) */
+#define UART_MAX_BAUD_ERROR 20
+
+/* Receive errors since reset; bytes with a framing or parity error are dropped */
+typedef struct
+{
+    uint16 framing;   // No stop bit where expected: noise or a rate mismatch
+    uint16 overrun;   // Bytes lost in the UART before the interrupt could run
+    uint16 parity;    // Parity mismatch, parity enabled only
+    uint16 overflow;  // Rx buffer full, newest byte lost
+} UART_ErrorStatsType;
+
+/*
+ * Fault injection on the transmitted bytes, to benchmark the link protocol
+ * against a noisy cable. Build both ECUs with the same settings, e.g.
+ * -DUART_FAULT_ENABLE=1 -DUART_FAULT_DROP=655 for 1% lost bytes.
+ */
+#ifndef UART_FAULT_ENABLE
+#define UART_FAULT_ENABLE 0
+#endif
+
+/* Default fault model, rates out of 65536 bytes */
+#ifndef UART_FAULT_DROP
+#define UART_FAULT_DROP 0
+#endif
+#ifndef UART_FAULT_DUPLICATE
+#define UART_FAULT_DUPLICATE 0
+#endif
+#ifndef UART_FAULT_CORRUPT
+#define UART_FAULT_CORRUPT 0
+#endif
+#ifndef UART_FAULT_JITTER_MS
+#define UART_FAULT_JITTER_MS 0
+#endif
+
+typedef struct
+{
+    uint16 dropRate;       // Bytes never sent, out of 65536
+    uint16 duplicateRate;  // Bytes sent twice, out of 65536
+    uint16 corruptRate;    // Bytes sent with one bit flipped, out of 65536
+    uint8 jitterMaxMs;     // Each byte is held back 0 to jitterMaxMs ms
+} UART_FaultModelType;
+
+typedef struct
+{
+    uint16 dropped;
+    uint16 duplicated;
+    uint16 corrupted;
+} UART_FaultStatsType;
+
 
 
 
@@ -46,8 +99,23 @@ typedef struct
  * 1. Setup the Frame format like number of data bits, parity bit type and number of stop bits.
  * 2. Enable the UART.
  * 3. Setup the UART baud rate.
+ * Returns FALSE, leaving the UART untouched, if the rate error exceeds UART_MAX_BAUD_ERROR.
+ */
+boolean UART_init(const UART_ConfigType *Config_Ptr);
+
+/*
+ * Description :
+ * Error of the baud rate actually generated for a requested rate, in 0.1%
+ * (e.g. 1 for 9600 bps at 8MHz, actually 0.16%). 0x7FFF if the rate cannot be generated.
+ */
+sint16 UART_getBaudError(uint32 baud_rate);
+
+/*
+ * Description :
+ * Switch to another baud rate after the last byte has been sent. Returns
+ * FALSE, keeping the current rate, if the error exceeds UART_MAX_BAUD_ERROR.
  */
-void UART_init(const UART_ConfigType *Config_Ptr);
+boolean UART_setBaudRate(uint32 baud_rate);
 
 /*
  * Description :
@@ -58,9 +126,48 @@ void UART_sendByte(const uint8 data);
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * Sleeps until a byte is received; global interrupts must be enabled.
  */
 uint8 UART_recieveByte(void);
 
+/*
+ * Description :
+ * Return TRUE if a received byte is waiting in the Rx buffer, without blocking.
+ */
+boolean UART_isDataAvailable(void);
+
+/*
+ * Description :
+ * Receive a byte, giving up after timeout_ms milliseconds. Returns FALSE on timeout.
+ */
+boolean UART_receiveByteTimeout(uint8 *data, uint16 timeout_ms);
+
+/*
+ * Description :
+ * Drop every byte waiting in the Rx buffer.
+ */
+void UART_flushRx(void);
+
+/*
+ * Description :
+ * Copy the receive error counters since reset.
+ */
+void UART_getErrorStats(UART_ErrorStatsType *stats);
+
+#if UART_FAULT_ENABLE
+/*
+ * Description :
+ * Replace the fault model applied to the transmitted bytes.
+ */
+void UART_setFaultModel(const UART_FaultModelType *model);
+
+/*
+ * Description :
+ * Copy the number of faults injected since reset.
+ */
+void UART_getFaultStats(UART_FaultStatsType *stats);
+#endif
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.
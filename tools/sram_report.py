@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""SRAM budget report from an avr-gcc linker map.
+
+Lists the .data (including read-only data that avr-gcc keeps in RAM) and
+.bss bytes each object file contributes, then the room left between the
+end of the static data and the top of RAM, which is all the stack gets.
+
+Usage: sram_report.py <file.map> [--ram-size BYTES] [--min-stack BYTES]
+
+Exits with status 1 when less than --min-stack bytes are left for the stack.
+The peak stack depth is only known at runtime, see stack_monitor.h.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+RAM_START = 0x800060  # ATmega32: after the 32 registers and 64 I/O registers
+RAM_SIZE = 2048
+
+# Input section lines: " .bss.name  0x00800076  0x1 ./file.o", the name may
+# be alone on the line with the address, size and file on the next one.
+SECTION_RE = re.compile(r"^ (\.data|\.rodata|\.bss|COMMON)(\S*)\s*$|^ (\.data|\.rodata|\.bss|COMMON)(\S*)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(.+)$")
+CONTINUATION_RE = re.compile(r"^\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(.+)$")
+OUTPUT_RE = re.compile(r"^(\.\w+)\s")
+END_RE = re.compile(r"^\s+0x([0-9a-f]+)\s+_end = \.")
+
+
+def module_name(path):
+    """Object file name, or library(member) for archive members."""
+    path = path.strip().replace("\\", "/")
+    match = re.search(r"([^/]+\.a)\((.+)\)$", path)
+    if match:
+        return "%s(%s)" % match.groups()
+    return os.path.basename(path)
+
+
+def parse_map(lines):
+    """Return ({module: {'data': n, 'bss': n}}, end address of static RAM)."""
+    modules = {}
+    output = None
+    pending = None
+    end = None
+
+    for line in lines:
+        line = line.rstrip("\r\n")
+
+        match = OUTPUT_RE.match(line)
+        if match:
+            output = match.group(1)
+            pending = None
+            continue
+
+        match = END_RE.match(line)
+        if match:
+            end = int(match.group(1), 16)
+            continue
+
+        if output not in (".data", ".bss"):
+            continue
+
+        kind = size = path = None
+        if pending is not None:
+            match = CONTINUATION_RE.match(line)
+            if match:
+                kind = pending
+                size = int(match.group(2), 16)
+                path = match.group(3)
+            pending = None
+
+        if kind is None:
+            match = SECTION_RE.match(line)
+            if not match:
+                continue
+            if match.group(1):
+                pending = match.group(1)
+                continue
+            kind = match.group(3)
+            size = int(match.group(6), 16)
+            path = match.group(7)
+
+        if size == 0:
+            continue
+        bucket = "bss" if kind in (".bss", "COMMON") else "data"
+        entry = modules.setdefault(module_name(path), {"data": 0, "bss": 0})
+        entry[bucket] += size
+
+    return modules, end
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map_file")
+    parser.add_argument("--ram-size", type=int, default=RAM_SIZE)
+    parser.add_argument("--min-stack", type=int, default=0,
+                        help="fail if fewer bytes are left for the stack")
+    args = parser.parse_args()
+
+    with open(args.map_file) as handle:
+        modules, end = parse_map(handle)
+
+    total_data = sum(m["data"] for m in modules.values())
+    total_bss = sum(m["bss"] for m in modules.values())
+    static = (end - RAM_START) if end is not None else total_data + total_bss
+    stack = args.ram_size - static
+
+    print("SRAM usage of %s" % os.path.basename(args.map_file))
+    print("  %-32s %6s %6s %6s" % ("module", ".data", ".bss", "total"))
+    for name in sorted(modules, key=lambda n: -(modules[n]["data"] + modules[n]["bss"])):
+        entry = modules[name]
+        print("  %-32s %6d %6d %6d" % (name, entry["data"], entry["bss"], entry["data"] + entry["bss"]))
+    print("  %-32s %6d %6d %6d" % ("total", total_data, total_bss, total_data + total_bss))
+    print("  static RAM %d of %d bytes, %d bytes left for the stack" % (static, args.ram_size, stack))
+
+    if stack < args.min_stack:
+        print("error: stack headroom %d bytes is below the %d byte minimum" % (stack, args.min_stack))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())